@@ -25,6 +25,7 @@ Copyright 2023 Erlend Andersen
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QPushButton>
 #include <QVBoxLayout>
 
 #include <array>
@@ -60,6 +61,17 @@ struct Phantom {
         }
         return QString {};
     }
+    ICRPPhantom phantom(QString basepath) const
+    {
+        return {
+            .name = name,
+            .organArrayPath = organArrayPath(basepath),
+            .organMediaPath = organDefinitionPath(basepath),
+            .mediaPath = mediaDefinitionPath(basepath),
+            .spacing_mm = spacing,
+            .dimensions = dimensions
+        };
+    }
 };
 
 static std::array<Phantom, 12> phantoms()
@@ -185,5 +197,25 @@ ICRPPhantomImportWidget::ICRPPhantomImportWidget(QWidget* parent)
     auto arm_label = new QLabel(tr("Replace arms on phantoms with air."), arm_box);
     arm_lay->addWidget(arm_label);
     lay->addWidget(arm_box);
+
+    auto batch_box = new QGroupBox(tr("Batch simulation"), this);
+    auto batch_lay = new QVBoxLayout;
+    batch_box->setLayout(batch_lay);
+    auto batch_label = new QLabel(tr("Simulate current beams on all ICRP phantoms. CT scan ranges, DX rotation centers and CBCT isocenters are moved along the body axis to cover the same anatomy of each phantom as of the currently loaded phantom, field sizes are kept and pencil beams are not moved. Organ doses for each phantom are shown in the dose table of the loaded image, which is kept."), batch_box);
+    batch_label->setWordWrap(true);
+    batch_lay->addWidget(batch_label);
+    auto batch_button = new QPushButton(tr("Simulate all phantoms"), batch_box);
+    batch_lay->addWidget(batch_button);
+    connect(batch_button, &QPushButton::clicked, [this, exeDirPath, arm_box]() {
+        QDir phantoms_path(exeDirPath);
+        phantoms_path.cd("data");
+        phantoms_path.cd("phantoms");
+        phantoms_path.cd("icrp");
+        std::vector<ICRPPhantom> batch;
+        for (const auto& p : phantoms())
+            batch.push_back(p.phantom(phantoms_path.absolutePath()));
+        emit this->requestBatchSimulation(batch, arm_box->isChecked());
+    });
+    lay->addWidget(batch_box);
     lay->addStretch(100);
 }
@@ -18,8 +18,12 @@ Copyright 2023 Erlend Andersen
 
 #pragma once
 
+#include <icrpphantomimportpipeline.hpp>
+
 #include <QWidget>
 
+#include <vector>
+
 class ICRPPhantomImportWidget : public QWidget {
     Q_OBJECT
 public:
@@ -27,6 +31,7 @@ public:
 signals:
     void setRemoveArms(bool);
     void requestImportPhantom(QString organArrayPath, QString organMediaPath, QString mediaPath, double, double, double, int, int, int);
+    void requestBatchSimulation(std::vector<ICRPPhantom> phantoms, bool removeArms);
 
 private:
 };
@@ -29,14 +29,20 @@ Copyright 2024 Erlend Andersen
 #include <ctdicomimportwidget.hpp>
 #include <ctimageimportpipeline.hpp>
 #include <ctsegmentationpipeline.hpp>
+#include <dosecomparisonpipeline.hpp>
+#include <dosecomparisonwidget.hpp>
 #include <dosetablepipeline.hpp>
 #include <dosetablewidget.hpp>
+#include <dvhpipeline.hpp>
+#include <dvhwidget.hpp>
 #include <h5io.hpp>
 #include <icrpphantomimportpipeline.hpp>
 #include <icrpphantomimportwidget.hpp>
 #include <otherphantomimportpipeline.hpp>
 #include <otherphantomimportwidget.hpp>
 #include <renderwidgetscollection.hpp>
+#include <roidosepipeline.hpp>
+#include <roidosewidget.hpp>
 #include <simulationpipeline.hpp>
 #include <simulationwidget.hpp>
 #include <statusbar.hpp>
@@ -175,10 +181,26 @@ MainWindow::MainWindow(QWidget* parent)
     connect(icrppipeline, &ICRPPhantomImportPipeline::imageDataChanged, simulationpipeline, &SimulationPipeline::updateImageData);
     connect(otherphantompipeline, &OtherPhantomImportPipeline::imageDataChanged, simulationpipeline, &SimulationPipeline::updateImageData);
     connect(simulationwidget, &SimulationWidget::numberOfThreadsChanged, simulationpipeline, &SimulationPipeline::setNumberOfThreads);
+    connect(simulationwidget, &SimulationWidget::threadPlacementChanged, simulationpipeline, &SimulationPipeline::setThreadPlacement);
+    connect(simulationwidget, &SimulationWidget::memoryPlacementChanged, simulationpipeline, &SimulationPipeline::setMemoryPlacement);
     connect(simulationwidget, &SimulationWidget::ignoreAirChanged, simulationpipeline, &SimulationPipeline::setDeleteAirDose);
+    connect(simulationpipeline, &SimulationPipeline::deleteAirDoseChanged, simulationwidget, &SimulationWidget::setIgnoreAir);
+    connect(simulationwidget, &SimulationWidget::cropAirChanged, simulationpipeline, &SimulationPipeline::setCropAir);
+    connect(simulationwidget, &SimulationWidget::organDoseOnlyChanged, simulationpipeline, &SimulationPipeline::setOrganDoseOnly);
+    connect(simulationwidget, &SimulationWidget::adaptiveBeamAllocationChanged, simulationpipeline, &SimulationPipeline::setAdaptiveBeamAllocation);
+    connect(simulationwidget, &SimulationWidget::varianceReductionChanged, simulationpipeline, &SimulationPipeline::setVarianceReduction);
+    connect(simulationwidget, &SimulationWidget::organsOfInterestChanged, simulationpipeline, &SimulationPipeline::setOrgansOfInterest);
     connect(simulationwidget, &SimulationWidget::requestStartSimulation, simulationpipeline, &SimulationPipeline::startSimulation);
+    connect(simulationwidget, &SimulationWidget::requestStartPreviewSimulation, simulationpipeline, &SimulationPipeline::startPreviewSimulation);
+    connect(simulationwidget, &SimulationWidget::requestStartSweep, simulationpipeline, &SimulationPipeline::startSweep);
+    connect(icrpimportwidget, &ICRPPhantomImportWidget::requestBatchSimulation, simulationpipeline, &SimulationPipeline::startBatchSimulation);
     connect(simulationwidget, &SimulationWidget::requestStopSimulation, simulationpipeline, &SimulationPipeline::stopSimulation);
+    connect(simulationwidget, &SimulationWidget::requestPauseSimulation, simulationpipeline, &SimulationPipeline::setSimulationPaused);
+    connect(simulationwidget, &SimulationWidget::requestCalibrateNumberOfThreads, simulationpipeline, &SimulationPipeline::calibrateNumberOfThreads);
+    connect(simulationpipeline, &SimulationPipeline::numberOfThreadsCalibrated, simulationwidget, &SimulationWidget::setCalibratedNumberOfThreads);
     connect(simulationwidget, &SimulationWidget::lowEnergyCorrectionMethodChanged, simulationpipeline, &SimulationPipeline::setLowEnergyCorrectionLevel);
+    connect(simulationwidget, &SimulationWidget::worldItemTypeChanged, simulationpipeline, &SimulationPipeline::setWorldItemType);
+    connect(simulationwidget, &SimulationWidget::doseScoringBlockSizeChanged, simulationpipeline, &SimulationPipeline::setDoseScoringBlockSize);
     connect(simulationpipeline, &SimulationPipeline::simulationReady, simulationwidget, &SimulationWidget::setSimulationReady);
     connect(beamsettingsmodel, &BeamSettingsView::beamActorAdded, simulationpipeline, &SimulationPipeline::addBeamActor);
     connect(beamsettingsmodel, &BeamSettingsView::beamActorRemoved, simulationpipeline, &SimulationPipeline::removeBeamActor);
@@ -188,20 +210,68 @@ MainWindow::MainWindow(QWidget* parent)
     connect(simulationpipeline, &SimulationPipeline::simulationRunning, icrpimportwidget, &ICRPPhantomImportWidget::setDisabled);
     connect(simulationpipeline, &SimulationPipeline::simulationRunning, simulationwidget, &SimulationWidget::setSimulationRunning);
     connect(simulationpipeline, &SimulationPipeline::simulationProgress, simulationwidget, &SimulationWidget::updateSimulationProgress);
+    connect(simulationpipeline, &SimulationPipeline::simulationProgressStatus, simulationwidget, &SimulationWidget::updateSimulationProgressStatus);
+    connect(simulationpipeline, &SimulationPipeline::simulationThroughput, simulationwidget, &SimulationWidget::setSimulationThroughput);
+    connect(simulationpipeline, &SimulationPipeline::simulationMemoryEstimated, simulationwidget, &SimulationWidget::setSimulationMemoryEstimate);
+    connect(simulationpipeline, &SimulationPipeline::organNamesChanged, simulationwidget, &SimulationWidget::setOrganNames);
+    connect(simulationpipeline, &SimulationPipeline::simulationFigureOfMerit, simulationwidget, &SimulationWidget::setSimulationFigureOfMerit);
 
     // dosetable
     auto dosetable = new DoseTableWidget(this);
     menuWidget->addTab(dosetable, tr("Organ Doses"));
     auto dosetablepipeline = new DoseTablePipeline;
     dosetablepipeline->moveToThread(&m_workerThread);
-    connect(dosetablepipeline, &DoseTablePipeline::clearTable, dosetable, &DoseTableWidget::clear);
-    connect(dosetablepipeline, &DoseTablePipeline::enableSorting, dosetable, &DoseTableWidget::enableSorting);
-    connect(dosetablepipeline, &DoseTablePipeline::doseData, dosetable, &DoseTableWidget::setDoseData);
-    connect(dosetablepipeline, &DoseTablePipeline::doseDataHeader, dosetable, &DoseTableWidget::setDoseDataHeader);
+    connect(dosetablepipeline, &DoseTablePipeline::doseTableChanged, dosetable, &DoseTableWidget::setDoseTable);
     connect(simulationpipeline, &SimulationPipeline::imageDataChanged, dosetablepipeline, &DoseTablePipeline::updateImageData);
     connect(simulationpipeline, &SimulationPipeline::simulationRunning, dosetablepipeline, &DoseTablePipeline::clearDoseTable);
     connect(ctimageimportpipeline, &CTImageImportPipeline::imageDataChanged, dosetablepipeline, &DoseTablePipeline::updateImageData);
 
+    // dose volume histograms
+    auto dvhwidget = new DVHWidget(this);
+    menuWidget->addTab(dvhwidget, tr("Dose Volume Histograms"));
+    auto dvhpipeline = new DVHPipeline;
+    dvhpipeline->moveToThread(&m_workerThread);
+    statusBar->registerPipeline(dvhpipeline);
+    connect(dvhpipeline, &DVHPipeline::dvhChanged, dvhwidget, &DVHWidget::setDVH);
+    connect(dvhwidget, &DVHWidget::requestExportCSV, dvhpipeline, &DVHPipeline::exportCSV);
+    connect(dvhpipeline, &DVHPipeline::errorMessage, dvhwidget, &DVHWidget::setMessage);
+    connect(simulationpipeline, &SimulationPipeline::imageDataChanged, dvhpipeline, &DVHPipeline::updateImageData);
+    connect(ctimageimportpipeline, &CTImageImportPipeline::imageDataChanged, dvhpipeline, &DVHPipeline::updateImageData);
+    connect(icrppipeline, &ICRPPhantomImportPipeline::imageDataChanged, dvhpipeline, &DVHPipeline::updateImageData);
+    connect(otherphantompipeline, &OtherPhantomImportPipeline::imageDataChanged, dvhpipeline, &DVHPipeline::updateImageData);
+
+    // region of interest dose
+    auto roidosewidget = new ROIDoseWidget(this);
+    menuWidget->addTab(roidosewidget, tr("ROI Dose"));
+    auto roidosepipeline = new ROIDosePipeline;
+    roidosepipeline->moveToThread(&m_workerThread);
+    statusBar->registerPipeline(roidosepipeline);
+    connect(roidosepipeline, &ROIDosePipeline::organNamesChanged, roidosewidget, &ROIDoseWidget::setOrganNames);
+    connect(roidosepipeline, &ROIDosePipeline::roiDoseComputed, roidosewidget, &ROIDoseWidget::setROIDose);
+    connect(roidosewidget, &ROIDoseWidget::requestBoxDose, roidosepipeline, &ROIDosePipeline::computeBox);
+    connect(roidosewidget, &ROIDoseWidget::requestSphereDose, roidosepipeline, &ROIDosePipeline::computeSphere);
+    connect(simulationpipeline, &SimulationPipeline::imageDataChanged, roidosepipeline, &ROIDosePipeline::updateImageData);
+    connect(ctimageimportpipeline, &CTImageImportPipeline::imageDataChanged, roidosepipeline, &ROIDosePipeline::updateImageData);
+    connect(icrppipeline, &ICRPPhantomImportPipeline::imageDataChanged, roidosepipeline, &ROIDosePipeline::updateImageData);
+    connect(otherphantompipeline, &OtherPhantomImportPipeline::imageDataChanged, roidosepipeline, &ROIDosePipeline::updateImageData);
+
+    // dose comparison against a saved reference
+    auto dosecomparisonwidget = new DoseComparisonWidget(this);
+    menuWidget->addTab(dosecomparisonwidget, tr("Dose Comparison"));
+    auto dosecomparisonpipeline = new DoseComparisonPipeline;
+    dosecomparisonpipeline->moveToThread(&m_workerThread);
+    statusBar->registerPipeline(dosecomparisonpipeline);
+    connect(dosecomparisonwidget, &DoseComparisonWidget::requestSetReference, dosecomparisonpipeline, &DoseComparisonPipeline::setReference);
+    connect(dosecomparisonwidget, &DoseComparisonWidget::requestClearReference, dosecomparisonpipeline, &DoseComparisonPipeline::clearReference);
+    connect(dosecomparisonpipeline, &DoseComparisonPipeline::comparisonTableChanged, dosecomparisonwidget, &DoseComparisonWidget::setComparisonTable);
+    connect(dosecomparisonpipeline, &DoseComparisonPipeline::referenceChanged, dosecomparisonwidget, &DoseComparisonWidget::setReference);
+    connect(dosecomparisonpipeline, &DoseComparisonPipeline::errorMessage, dosecomparisonwidget, &DoseComparisonWidget::setMessage);
+    connect(dosecomparisonpipeline, &DoseComparisonPipeline::imageDataChanged, slicerender, &RenderWidgetsCollection::updateImageData);
+    connect(simulationpipeline, &SimulationPipeline::imageDataChanged, dosecomparisonpipeline, &DoseComparisonPipeline::updateImageData);
+    connect(ctimageimportpipeline, &CTImageImportPipeline::imageDataChanged, dosecomparisonpipeline, &DoseComparisonPipeline::updateImageData);
+    connect(icrppipeline, &ICRPPhantomImportPipeline::imageDataChanged, dosecomparisonpipeline, &DoseComparisonPipeline::updateImageData);
+    connect(otherphantompipeline, &OtherPhantomImportPipeline::imageDataChanged, dosecomparisonpipeline, &DoseComparisonPipeline::updateImageData);
+
     // save load
     auto h5io = new H5IO;
     h5io->moveToThread(&m_workerThread);
@@ -219,6 +289,9 @@ MainWindow::MainWindow(QWidget* parent)
     connect(this, &MainWindow::loadData, h5io, &H5IO::loadData);
     connect(h5io, &H5IO::imageDataChanged, simulationpipeline, &SimulationPipeline::updateImageData);
     connect(h5io, &H5IO::imageDataChanged, dosetablepipeline, &DoseTablePipeline::updateImageData);
+    connect(h5io, &H5IO::imageDataChanged, dvhpipeline, &DVHPipeline::updateImageData);
+    connect(h5io, &H5IO::imageDataChanged, roidosepipeline, &ROIDosePipeline::updateImageData);
+    connect(h5io, &H5IO::imageDataChanged, dosecomparisonpipeline, &DoseComparisonPipeline::updateImageData);
     connect(h5io, &H5IO::imageDataChanged, beamsettingswidget, &BeamSettingsWidget::updateImageData);
     connect(h5io, &H5IO::imageDataChanged, slicerender, &RenderWidgetsCollection::updateImageData);
     connect(h5io, &H5IO::imageDataChanged, simulationpipeline, &SimulationPipeline::updateImageData);
@@ -260,6 +333,19 @@ void MainWindow::createMenu()
     openAction->setStatusTip(tr("Open a previously saved simulation"));
     connect(openAction, &QAction::triggered, this, &MainWindow::loadFileAction);
     fileMenu->addAction(openAction);
+
+    auto statisticsAction = new QAction(tr("Save simulation statistics as JSON"), this);
+    statisticsAction->setCheckable(true);
+    statisticsAction->setStatusTip(tr("Write timings and throughput of the last simulation to a JSON file next to the saved simulation"));
+    {
+        QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+        statisticsAction->setChecked(settings.value("saveload/statisticsjson", false).toBool());
+    }
+    connect(statisticsAction, &QAction::toggled, [](bool checked) {
+        QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+        settings.setValue("saveload/statisticsjson", checked);
+    });
+    fileMenu->addAction(statisticsAction);
 }
 
 QString directoryPath(const QString& path)
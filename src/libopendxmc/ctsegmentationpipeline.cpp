@@ -18,6 +18,7 @@ Copyright 2024 Erlend Andersen
 
 #include <ctsegmentationpipeline.hpp>
 #include <dxmc_specialization.hpp>
+#include <materialcache.hpp>
 
 #include "dxmc/beams/tube/tube.hpp"
 #include "dxmc/material/nistmaterials.hpp"
@@ -70,9 +71,9 @@ CTNumberData getMeanCTNumbers(const std::vector<MatDens>& materials, double al_f
     const auto spec_en = tube.getEnergy();
     const auto spec_w = tube.getSpecter(spec_en, true);
 
-    const auto air = Material::byNistName("Air, Dry (near sea level)").value();
+    const auto air = MaterialCache::byNistName("Air, Dry (near sea level)").value();
     const auto air_dens = NISTMaterials::density("Air, Dry (near sea level)");
-    const auto water = Material::byNistName("Water, Liquid").value();
+    const auto water = MaterialCache::byNistName("Water, Liquid").value();
     const auto water_dens = NISTMaterials::density("Water, Liquid");
 
     data.HU.resize(materials.size());
@@ -121,7 +122,7 @@ void CTSegmentationPipeline::updateImageData(std::shared_ptr<DataContainer> data
 
     std::vector<MatDens> materials;
     for (const auto& n : mat_names)
-        materials.push_back(std::make_pair(Material::byNistName(n).value(), NISTMaterials::density(n)));
+        materials.push_back(std::make_pair(MaterialCache::byNistName(n).value(), NISTMaterials::density(n)));
 
     // Density for bone is to high
     materials.back().second = 1.09;
@@ -22,7 +22,12 @@ Copyright 2023 Erlend Andersen
 #include <vtkImageImport.h>
 #include <vtkSmartPointer.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <execution>
+#include <string_view>
+#include <utility>
 
 std::uint64_t generateID(void)
 {
@@ -107,6 +112,21 @@ vtkSmartPointer<vtkImageData> DataContainer::vtkImage(ImageType type)
     return m_vtk_shallow_buffer[type];
 }
 
+bool DataContainer::isDoseImage(ImageType type)
+{
+    switch (type) {
+    case DataContainer::ImageType::Dose:
+    case DataContainer::ImageType::DoseVariance:
+    case DataContainer::ImageType::DoseCount:
+    case DataContainer::ImageType::DoseDifference:
+    case DataContainer::ImageType::DoseRatio:
+    case DataContainer::ImageType::DoseZScore:
+        return true;
+    default:
+        return false;
+    }
+}
+
 vtkSmartPointer<vtkImageData> DataContainer::generate_vtkImage(ImageType type)
 {
     if (!hasImage(type))
@@ -146,6 +166,18 @@ vtkSmartPointer<vtkImageData> DataContainer::generate_vtkImage(ImageType type)
         data = static_cast<void*>(m_dose_count_array.data());
         vtkimport->SetDataScalarTypeToDouble();
         break;
+    case DataContainer::ImageType::DoseDifference:
+        data = static_cast<void*>(m_dose_difference_array.data());
+        vtkimport->SetDataScalarTypeToDouble();
+        break;
+    case DataContainer::ImageType::DoseRatio:
+        data = static_cast<void*>(m_dose_ratio_array.data());
+        vtkimport->SetDataScalarTypeToDouble();
+        break;
+    case DataContainer::ImageType::DoseZScore:
+        data = static_cast<void*>(m_dose_zscore_array.data());
+        vtkimport->SetDataScalarTypeToDouble();
+        break;
     default:
         break;
     }
@@ -153,18 +185,33 @@ vtkSmartPointer<vtkImageData> DataContainer::generate_vtkImage(ImageType type)
     if (!data)
         return nullptr;
 
+    const bool doseImage = isDoseImage(type);
+    const auto dimensions = doseImage ? doseDimensions() : m_dimensions;
+    const auto spacing = doseImage ? doseSpacing() : m_spacing;
+    if (isAirMasked() && doseImage) {
+        // the viewed image is a masked copy, stored tallies are left untouched
+        auto& masked = m_masked_buffer[type];
+        const auto* source = static_cast<const double*>(data);
+        const auto& airMask = doseAirMask();
+        masked.resize(doseSize());
+        std::transform(std::execution::par_unseq, source, source + doseSize(), airMask.cbegin(), masked.begin(), [](const auto v, const auto air) {
+            return air ? 0.0 : v;
+        });
+        data = static_cast<void*>(masked.data());
+    }
+
     vtkimport->SetNumberOfScalarComponents(1);
     std::array<int, 6> extent;
     for (std::size_t i = 0; i < 3; ++i) {
         extent[2 * i] = 0;
-        extent[2 * i + 1] = static_cast<int>(m_dimensions[i] - 1);
+        extent[2 * i + 1] = static_cast<int>(dimensions[i] - 1);
     }
 
     vtkimport->SetWholeExtent(extent.data());
     vtkimport->SetDataExtent(extent.data());
     vtkimport->SetDataExtentToWholeExtent();
 
-    vtkimport->SetDataSpacing(m_spacing.data());
+    vtkimport->SetDataSpacing(spacing.data());
     // only a shallow reference
     vtkimport->SetImportVoidPointer(data);
     vtkimport->Update();
@@ -176,6 +223,11 @@ vtkSmartPointer<vtkImageData> DataContainer::generate_vtkImage(ImageType type)
         -(m_spacing[1] * m_dimensions[1]) / 2,
         -(m_spacing[2] * m_dimensions[2]) / 2
     };
+    if (doseImage) {
+        // first block is centered on its voxels
+        for (std::size_t i = 0; i < 3; ++i)
+            origin[i] += (m_doseScoringBlock - 1) * m_spacing[i] / 2;
+    }
 
     image->SetOrigin(origin.data());
     return image;
@@ -196,7 +248,10 @@ std::vector<DataContainer::ImageType> DataContainer::getAvailableImages() const
         ImageType::Material,
         ImageType::Dose,
         ImageType::DoseVariance,
-        ImageType::DoseCount
+        ImageType::DoseCount,
+        ImageType::DoseDifference,
+        ImageType::DoseRatio,
+        ImageType::DoseZScore
     };
     std::vector<ImageType> type_avail;
     for (const auto t : types)
@@ -232,6 +287,15 @@ std::string DataContainer::getImageAsString(ImageType type)
     case DataContainer::ImageType::DoseCount:
         name = "Dose tally";
         break;
+    case DataContainer::ImageType::DoseDifference:
+        name = "Dose difference";
+        break;
+    case DataContainer::ImageType::DoseRatio:
+        name = "Dose ratio";
+        break;
+    case DataContainer::ImageType::DoseZScore:
+        name = "Dose z-score";
+        break;
     default:
         break;
     }
@@ -277,11 +341,12 @@ bool DataContainer::setImageArray(ImageType type, const std::vector<double>& ima
 {
     // Might generate a new ID if an existing image is replaced
 
-    const auto N = size();
+    const auto N = isDoseImage(type) ? doseSize() : size();
     if (N != image.size())
         return false;
 
     m_vtk_shallow_buffer.erase(type);
+    m_masked_buffer.erase(type);
     updateIDifImageChanged(type);
 
     switch (type) {
@@ -300,6 +365,15 @@ bool DataContainer::setImageArray(ImageType type, const std::vector<double>& ima
     case DataContainer::ImageType::DoseCount:
         m_dose_count_array = image;
         return true;
+    case DataContainer::ImageType::DoseDifference:
+        m_dose_difference_array = image;
+        return true;
+    case DataContainer::ImageType::DoseRatio:
+        m_dose_ratio_array = image;
+        return true;
+    case DataContainer::ImageType::DoseZScore:
+        m_dose_zscore_array = image;
+        return true;
     default:
         return false;
     }
@@ -319,6 +393,7 @@ bool DataContainer::setImageArray(ImageType type, const std::vector<std::uint8_t
     switch (type) {
     case DataContainer::ImageType::Material:
         m_material_array = image;
+        updateAirMask();
         return true;
     case DataContainer::ImageType::Organ:
         m_organ_array = image;
@@ -329,20 +404,125 @@ bool DataContainer::setImageArray(ImageType type, const std::vector<std::uint8_t
     return false;
 }
 
+void DataContainer::removeImage(ImageType type)
+{
+    m_vtk_shallow_buffer.erase(type);
+    m_masked_buffer.erase(type);
+    updateIDifImageChanged(type);
+
+    switch (type) {
+    case DataContainer::ImageType::CT:
+        m_ct_array.clear();
+        m_ct_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::Density:
+        m_density_array.clear();
+        m_density_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::Material:
+        m_material_array.clear();
+        m_material_array.shrink_to_fit();
+        updateAirMask();
+        break;
+    case DataContainer::ImageType::Organ:
+        m_organ_array.clear();
+        m_organ_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::Dose:
+        m_dose_array.clear();
+        m_dose_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::DoseVariance:
+        m_dose_variance_array.clear();
+        m_dose_variance_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::DoseCount:
+        m_dose_count_array.clear();
+        m_dose_count_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::DoseDifference:
+        m_dose_difference_array.clear();
+        m_dose_difference_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::DoseRatio:
+        m_dose_ratio_array.clear();
+        m_dose_ratio_array.shrink_to_fit();
+        break;
+    case DataContainer::ImageType::DoseZScore:
+        m_dose_zscore_array.clear();
+        m_dose_zscore_array.shrink_to_fit();
+        break;
+    default:
+        break;
+    }
+}
+
+void DataContainer::removeDoseComparisonImages()
+{
+    removeImage(ImageType::DoseDifference);
+    removeImage(ImageType::DoseRatio);
+    removeImage(ImageType::DoseZScore);
+}
+
+void DataContainer::setOrganDoses(const std::vector<OrganDose>& doses)
+{
+    m_organ_doses = doses;
+}
+
 void DataContainer::updateIDifImageChanged(ImageType type)
 {
     if (hasImage(type)) {
         m_uid = generateID();
     }
 }
+
+void DataContainer::updateAirMask()
+{
+    m_air_mask.resize(m_material_array.size());
+    std::transform(std::execution::par_unseq, m_material_array.cbegin(), m_material_array.cend(), m_air_mask.begin(), [](const auto m) {
+        return m == 0 ? std::uint8_t { 1 } : std::uint8_t { 0 };
+    });
+    m_dose_air_mask.clear();
+    if (m_doseScoringBlock > 1 && m_air_mask.size() == size()) {
+        m_dose_air_mask.assign(doseSize(), 1);
+        for (std::size_t i = 0; i < m_air_mask.size(); ++i)
+            if (!m_air_mask[i])
+                m_dose_air_mask[doseIndex(i)] = 0;
+    }
+    invalidateMaskedImages();
+}
+
+void DataContainer::invalidateMaskedImages()
+{
+    for (auto it = m_vtk_shallow_buffer.begin(); it != m_vtk_shallow_buffer.end();) {
+        if (isDoseImage(it->first))
+            it = m_vtk_shallow_buffer.erase(it);
+        else
+            ++it;
+    }
+    m_masked_buffer.clear();
+}
+
+void DataContainer::setAirMasked(bool on)
+{
+    if (m_airMasked == on)
+        return;
+    m_airMasked = on;
+    invalidateMaskedImages();
+    // a new ID lets viewers and cached results pick up the changed view
+    if (hasImage(ImageType::Dose) || hasImage(ImageType::DoseDifference))
+        m_uid = generateID();
+}
 bool DataContainer::setImageArray(ImageType type, vtkSmartPointer<vtkImageData> image)
 {
     if (image == nullptr)
         return false;
 
+    const auto dimensions = isDoseImage(type) ? doseDimensions() : m_dimensions;
+    const auto N = dimensions[0] * dimensions[1] * dimensions[2];
     std::array<int, 3> image_dim;
     image->GetDimensions(image_dim.data());
-    if (image_dim[0] != m_dimensions[0] || image_dim[1] != m_dimensions[1] || image_dim[2] != m_dimensions[2])
+    if (image_dim[0] != dimensions[0] || image_dim[1] != dimensions[1] || image_dim[2] != dimensions[2])
         return false;
 
     if (image->GetNumberOfScalarComponents() != 1)
@@ -358,6 +538,7 @@ bool DataContainer::setImageArray(ImageType type, vtkSmartPointer<vtkImageData>
     }
 
     m_vtk_shallow_buffer.erase(type);
+    m_masked_buffer.erase(type);
     updateIDifImageChanged(type);
 
     // Oh horrors, we must have a void pointer to copy data from vtkImageData
@@ -369,31 +550,44 @@ bool DataContainer::setImageArray(ImageType type, vtkSmartPointer<vtkImageData>
     switch (type) {
     case DataContainer::ImageType::CT:
         buffer = vtkexport->GetPointerToData();
-        m_ct_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + size());
+        m_ct_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
         return true;
     case DataContainer::ImageType::Density:
         buffer = vtkexport->GetPointerToData();
-        m_density_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + size());
+        m_density_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
         return true;
     case DataContainer::ImageType::Material:
         buffer = vtkexport->GetPointerToData();
-        m_material_array = std::vector<std::uint8_t>(static_cast<std::uint8_t*>(buffer), static_cast<std::uint8_t*>(buffer) + size());
+        m_material_array = std::vector<std::uint8_t>(static_cast<std::uint8_t*>(buffer), static_cast<std::uint8_t*>(buffer) + N);
+        updateAirMask();
         return true;
     case DataContainer::ImageType::Organ:
         buffer = vtkexport->GetPointerToData();
-        m_organ_array = std::vector<std::uint8_t>(static_cast<std::uint8_t*>(buffer), static_cast<std::uint8_t*>(buffer) + size());
+        m_organ_array = std::vector<std::uint8_t>(static_cast<std::uint8_t*>(buffer), static_cast<std::uint8_t*>(buffer) + N);
         return true;
     case DataContainer::ImageType::Dose:
         buffer = vtkexport->GetPointerToData();
-        m_dose_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + size());
+        m_dose_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
         return true;
     case DataContainer::ImageType::DoseVariance:
         buffer = vtkexport->GetPointerToData();
-        m_dose_variance_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + size());
+        m_dose_variance_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
         return true;
     case DataContainer::ImageType::DoseCount:
         buffer = vtkexport->GetPointerToData();
-        m_dose_count_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + size());
+        m_dose_count_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
+        return true;
+    case DataContainer::ImageType::DoseDifference:
+        buffer = vtkexport->GetPointerToData();
+        m_dose_difference_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
+        return true;
+    case DataContainer::ImageType::DoseRatio:
+        buffer = vtkexport->GetPointerToData();
+        m_dose_ratio_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
+        return true;
+    case DataContainer::ImageType::DoseZScore:
+        buffer = vtkexport->GetPointerToData();
+        m_dose_zscore_array = std::vector<double>(static_cast<double*>(buffer), static_cast<double*>(buffer) + N);
         return true;
     default:
         break;
@@ -405,9 +599,61 @@ std::size_t DataContainer::size() const
 {
     return m_dimensions[0] * m_dimensions[1] * m_dimensions[2];
 }
+
+void DataContainer::setDoseScoringBlock(std::size_t block)
+{
+    block = std::max(block, std::size_t { 1 });
+    if (block == m_doseScoringBlock)
+        return;
+    for (const auto type : { ImageType::Dose, ImageType::DoseVariance, ImageType::DoseCount, ImageType::DoseDifference, ImageType::DoseRatio, ImageType::DoseZScore })
+        removeImage(type);
+    m_doseScoringBlock = block;
+    updateAirMask();
+}
+
+std::array<std::size_t, 3> DataContainer::doseDimensions() const
+{
+    std::array<std::size_t, 3> dim;
+    for (std::size_t i = 0; i < 3; ++i)
+        dim[i] = (m_dimensions[i] + m_doseScoringBlock - 1) / m_doseScoringBlock;
+    return dim;
+}
+
+std::array<double, 3> DataContainer::doseSpacing() const
+{
+    std::array<double, 3> spacing;
+    for (std::size_t i = 0; i < 3; ++i)
+        spacing[i] = m_spacing[i] * m_doseScoringBlock;
+    return spacing;
+}
+
+std::size_t DataContainer::doseSize() const
+{
+    const auto dim = doseDimensions();
+    return dim[0] * dim[1] * dim[2];
+}
 void DataContainer::setDoseUnits(const std::string& unit)
 {
-    m_doseUnits = unit;
+    constexpr std::array<std::pair<std::string_view, double>, 3> scales = { { { "uGy", 1e3 }, { "mGy", 1 }, { "Gy", 1e-3 } } };
+    for (const auto& [name, scale] : scales) {
+        if (name == unit) {
+            m_doseUnits = unit;
+            m_doseDisplayScale = scale;
+        }
+    }
+}
+
+double DataContainer::displayScale(ImageType type) const
+{
+    switch (type) {
+    case DataContainer::ImageType::Dose:
+    case DataContainer::ImageType::DoseDifference:
+        return m_doseDisplayScale;
+    case DataContainer::ImageType::DoseVariance:
+        return m_doseDisplayScale * m_doseDisplayScale;
+    default:
+        return 1;
+    }
 }
 std::string DataContainer::units(ImageType type) const
 {
@@ -421,11 +667,17 @@ std::string DataContainer::units(ImageType type) const
     case DataContainer::ImageType::Organ:
         return "";
     case DataContainer::ImageType::Dose:
-        return m_doseUnits;
+        return m_dosePreview ? m_doseUnits + " (preview)" : m_doseUnits;
     case DataContainer::ImageType::DoseVariance:
-        return m_doseUnits + "^2";
+        return m_dosePreview ? m_doseUnits + "^2 (preview)" : m_doseUnits + "^2";
     case DataContainer::ImageType::DoseCount:
         return "N events";
+    case DataContainer::ImageType::DoseDifference:
+        return m_doseUnits;
+    case DataContainer::ImageType::DoseRatio:
+        return "";
+    case DataContainer::ImageType::DoseZScore:
+        return "z";
     default:
         return "";
     }
@@ -436,7 +688,7 @@ bool DataContainer::hasImage(ImageType type) const
     if (m_uid == 0)
         return false;
 
-    const auto N = size();
+    const auto N = isDoseImage(type) ? doseSize() : size();
     std::size_t N_image = 0;
     switch (type) {
     case DataContainer::ImageType::CT:
@@ -460,6 +712,15 @@ bool DataContainer::hasImage(ImageType type) const
     case DataContainer::ImageType::DoseCount:
         N_image = m_dose_count_array.size();
         break;
+    case DataContainer::ImageType::DoseDifference:
+        N_image = m_dose_difference_array.size();
+        break;
+    case DataContainer::ImageType::DoseRatio:
+        N_image = m_dose_ratio_array.size();
+        break;
+    case DataContainer::ImageType::DoseZScore:
+        N_image = m_dose_zscore_array.size();
+        break;
     default:
         N_image = 0;
         break;
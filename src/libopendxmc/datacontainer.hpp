@@ -39,7 +39,10 @@ public:
         Organ,
         Dose,
         DoseVariance,
-        DoseCount
+        DoseCount,
+        DoseDifference,
+        DoseRatio,
+        DoseZScore
     };
 
     struct Material {
@@ -47,6 +50,52 @@ public:
         std::map<std::uint64_t, double> Z;
     };
 
+    // Dose tallied directly per organ, used when no voxel dose arrays are stored
+    struct OrganDose {
+        std::string name;
+        std::uint64_t voxels = 0;
+        double volume = 0;
+        double mass = 0;
+        double dose = 0;
+        double variance = 0;
+        double events = 0;
+    };
+
+    // Organ doses for one beam variant of a parameter sweep
+    struct SweepResult {
+        std::string name;
+        std::vector<OrganDose> doses;
+    };
+
+    struct BeamStatistics {
+        std::string name;
+        double transportTime = 0; // seconds
+        std::uint64_t histories = 0;
+        double historiesPerSecond() const { return transportTime > 0 ? histories / transportTime : 0; }
+    };
+
+    // Performance of the last simulation, times in seconds
+    struct SimulationStatistics {
+        std::string version;
+        std::string host;
+        std::string cpuArchitecture;
+        std::string operatingSystem;
+        std::string trackingMethod;
+        int logicalCpus = 0;
+        int threads = 0;
+        int correctionLevel = 0;
+        double worldBuildTime = 0;
+        double pilotTime = 0;
+        double transportTime = 0;
+        double doseCollectionTime = 0;
+        double wallTime = 0;
+        std::uint64_t histories = 0;
+        bool varianceReduction = false;
+        double figureOfMerit = 0; // of organs of interest, zero if not computed
+        std::vector<BeamStatistics> beams;
+        double historiesPerSecond() const { return transportTime > 0 ? histories / transportTime : 0; }
+    };
+
     DataContainer();
     void setSpacing(const std::array<double, 3>& cm);
     void setSpacingInmm(const std::array<double, 3>& mm);
@@ -58,6 +107,12 @@ public:
     bool setImageArray(ImageType type, const std::vector<double>& image);
     bool setImageArray(ImageType type, const std::vector<std::uint8_t>& image);
     bool setImageArray(ImageType type, vtkSmartPointer<vtkImageData> image);
+    void removeImage(ImageType type);
+    // Difference, ratio and z-score maps against a reference dose
+    void removeDoseComparisonImages();
+    void setOrganDoses(const std::vector<OrganDose>& doses);
+    void setSimulationStatistics(const SimulationStatistics& statistics) { m_simulation_statistics = statistics; }
+    void setSweepResults(const std::vector<SweepResult>& results) { m_sweep_results = results; }
 
     std::size_t size() const;
     bool hasImage(ImageType type) const;
@@ -75,6 +130,9 @@ public:
     const std::vector<double>& getDoseArray() const { return m_dose_array; }
     const std::vector<double>& getDoseVarianceArray() const { return m_dose_variance_array; }
     const std::vector<double>& getDoseEventCountArray() const { return m_dose_count_array; }
+    const std::vector<double>& getDoseDifferenceArray() const { return m_dose_difference_array; }
+    const std::vector<double>& getDoseRatioArray() const { return m_dose_ratio_array; }
+    const std::vector<double>& getDoseZScoreArray() const { return m_dose_zscore_array; }
     const std::vector<std::uint8_t>& getMaterialArray() const { return m_material_array; }
     const std::vector<std::uint8_t>& getOrganArray() const { return m_organ_array; }
 
@@ -83,13 +141,59 @@ public:
 
     const std::vector<DataContainer::Material>& getMaterials() const { return m_materials; }
     const std::vector<std::string>& getOrganNames() const { return m_organ_names; }
+    const std::vector<OrganDose>& getOrganDoses() const { return m_organ_doses; }
+    bool hasOrganDoses() const { return !m_organ_doses.empty(); }
+    const SimulationStatistics& getSimulationStatistics() const { return m_simulation_statistics; }
+    bool hasSimulationStatistics() const { return m_simulation_statistics.histories > 0; }
+    const std::vector<SweepResult>& getSweepResults() const { return m_sweep_results; }
+    bool hasSweepResults() const { return !m_sweep_results.empty(); }
+
+    // Dose images are masked in air (material 0) when viewed or exported, tallies are kept so
+    // masking can be toggled without simulating again
+    void setAirMasked(bool on);
+    bool isAirMasked() const { return m_airMasked && m_air_mask.size() == size(); }
+    // One for voxels of material 0, computed once when the material array is set. Bytes rather than
+    // std::vector<bool> so the mask can be used with parallel algorithms.
+    const std::vector<std::uint8_t>& airMask() const { return m_air_mask; }
+    // Air mask of the dose grid, a block is air if all its voxels are
+    const std::vector<std::uint8_t>& doseAirMask() const { return m_doseScoringBlock > 1 ? m_dose_air_mask : m_air_mask; }
+
+    // Dose images (dose, variance, event count and comparison maps) are stored on a grid of blocks of
+    // block^3 voxels if dose is scored in blocks. Blocks are aligned with the first voxel and the last
+    // block along each axis may be partial. Changing the block size removes dose images.
+    void setDoseScoringBlock(std::size_t block);
+    std::size_t doseScoringBlock() const { return m_doseScoringBlock; }
+    std::array<std::size_t, 3> doseDimensions() const;
+    std::array<double, 3> doseSpacing() const;
+    std::size_t doseSize() const;
+    // Index in dose images of a voxel
+    std::size_t doseIndex(std::size_t voxelIdx) const
+    {
+        if (m_doseScoringBlock == 1)
+            return voxelIdx;
+        const auto x = voxelIdx % m_dimensions[0];
+        const auto y = (voxelIdx / m_dimensions[0]) % m_dimensions[1];
+        const auto z = voxelIdx / (m_dimensions[0] * m_dimensions[1]);
+        const auto ddim = doseDimensions();
+        return x / m_doseScoringBlock + ddim[0] * (y / m_doseScoringBlock + ddim[1] * (z / m_doseScoringBlock));
+    }
+    // True for dose images, which are stored on the dose grid
+    static bool isDoseImage(ImageType type);
 
     std::string units(ImageType type) const;
+    // Dose arrays are always stored in mGy, the dose unit only sets the scale used for display
     void setDoseUnits(const std::string& unit);
+    const std::string& doseUnits() const { return m_doseUnits; }
+    // Factor from stored values to displayed units for the image type
+    double displayScale(ImageType type) const;
+    void setDosePreview(bool on) { m_dosePreview = on; }
+    bool isDosePreview() const { return m_dosePreview; }
 
 protected:
     vtkSmartPointer<vtkImageData> generate_vtkImage(ImageType);
     void updateIDifImageChanged(ImageType);
+    void updateAirMask();
+    void invalidateMaskedImages();
 
 private:
     std::uint64_t m_uid = 0;
@@ -103,10 +207,23 @@ private:
     std::vector<double> m_dose_variance_array;
     CTAECFilter m_aecdata;
     std::vector<double> m_dose_count_array;
+    std::vector<double> m_dose_difference_array;
+    std::vector<double> m_dose_ratio_array;
+    std::vector<double> m_dose_zscore_array;
     std::vector<DataContainer::Material> m_materials;
     std::vector<std::string> m_organ_names;
+    std::vector<OrganDose> m_organ_doses;
+    SimulationStatistics m_simulation_statistics;
+    std::vector<SweepResult> m_sweep_results;
     std::map<ImageType, vtkSmartPointer<vtkImageData>> m_vtk_shallow_buffer;
+    std::vector<std::uint8_t> m_air_mask;
+    std::vector<std::uint8_t> m_dose_air_mask; // empty if dose is scored per voxel
+    std::size_t m_doseScoringBlock = 1;
+    bool m_airMasked = false;
+    std::map<ImageType, std::vector<double>> m_masked_buffer;
     std::string m_doseUnits = "mGy";
+    double m_doseDisplayScale = 1;
+    bool m_dosePreview = false;
 };
 
 // Allow std::shared_ptr<DataContainer> to be used in signal/slots
@@ -0,0 +1,109 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dosecomparison.hpp>
+#include <organaccumulator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <numeric>
+
+std::shared_ptr<DoseComparison> DoseComparison::compare(std::shared_ptr<const DataContainer> data, std::shared_ptr<const DataContainer> reference)
+{
+    if (!data || !reference)
+        return nullptr;
+    if (!data->hasImage(DataContainer::ImageType::Dose) || !reference->hasImage(DataContainer::ImageType::Dose))
+        return nullptr;
+    if (data->dimensions() != reference->dimensions() || data->doseScoringBlock() != reference->doseScoringBlock())
+        return nullptr;
+    for (std::size_t i = 0; i < 3; ++i)
+        if (std::abs(data->spacing()[i] - reference->spacing()[i]) > 1e-6 * data->spacing()[i])
+            return nullptr;
+
+    auto res = std::make_shared<DoseComparison>();
+
+    const auto& dose = data->getDoseArray();
+    const auto& referenceDose = reference->getDoseArray();
+    const auto& variance = data->getDoseVarianceArray();
+    const auto& referenceVariance = reference->getDoseVarianceArray();
+    const auto& density = data->getDensityArray();
+    const auto& organArray = data->getOrganArray();
+
+    // maps are on the dose grid, organ sums are over voxels
+    const auto Nd = data->doseSize();
+    const auto N = data->size();
+    const bool hasVariance = variance.size() == Nd;
+    const bool hasReferenceVariance = referenceVariance.size() == Nd;
+    const bool hasOrgans = organArray.size() == N && density.size() == N;
+    // maps are kept in air and masked when viewed, organ sums exclude dose to air if masked
+    const std::vector<std::uint8_t> noMask;
+    const auto& airMask = data->isAirMasked() ? data->airMask() : noMask;
+    const auto voxelVolume = std::reduce(data->spacing().cbegin(), data->spacing().cend(), 1.0, std::multiplies {});
+
+    const auto combinedVariance = [&](const std::size_t i) {
+        return (hasVariance ? variance[i] : 0.0) + (hasReferenceVariance ? referenceVariance[i] : 0.0);
+    };
+    res->m_difference.resize(Nd);
+    res->m_ratio.resize(Nd);
+    if (hasVariance || hasReferenceVariance)
+        res->m_zscore.resize(Nd);
+    std::vector<std::size_t> idx(Nd);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::for_each(std::execution::par_unseq, idx.cbegin(), idx.cend(), [&](const std::size_t i) {
+        const auto d = dose[i];
+        const auto r = referenceDose[i];
+        res->m_difference[i] = d - r;
+        res->m_ratio[i] = r > 0 ? d / r : 0.0;
+        if (!res->m_zscore.empty()) {
+            const auto var = combinedVariance(i);
+            res->m_zscore[i] = var > 0 ? (d - r) / std::sqrt(var) : 0.0;
+        }
+    });
+    if (!hasOrgans)
+        return res;
+
+    // the variance is of the difference in energy imparted
+    const auto total = accumulateOrgans(organArray, density, voxelVolume, airMask, [&](const std::size_t i) {
+        const auto di = data->doseIndex(i);
+        return VoxelDose { .dose = dose[di], .variance = combinedVariance(di) };
+    });
+    const auto referenceTotal = accumulateOrgans(organArray, density, voxelVolume, airMask, [&](const std::size_t i) {
+        return VoxelDose { .dose = referenceDose[data->doseIndex(i)] };
+    });
+
+    const auto& names = data->getOrganNames();
+    for (std::size_t o = 0; o < std::min(names.size(), total.size()); ++o) {
+        const auto& acc = total[o];
+        if (acc.voxels == 0 || acc.mass <= 0)
+            continue;
+        Organ organ;
+        organ.name = names[o];
+        organ.voxels = acc.voxels;
+        organ.mass = acc.mass;
+        organ.dose = acc.energy / acc.mass;
+        organ.referenceDose = referenceTotal[o].energy / acc.mass;
+        organ.difference = organ.dose - organ.referenceDose;
+        organ.ratio = organ.referenceDose > 0 ? organ.dose / organ.referenceDose : 0.0;
+        const auto stderror = std::sqrt(acc.variance) / acc.mass;
+        organ.zScore = stderror > 0 ? organ.difference / stderror : 0.0;
+        res->m_organs.push_back(organ);
+    }
+    return res;
+}
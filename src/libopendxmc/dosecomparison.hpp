@@ -0,0 +1,58 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <datacontainer.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Voxel by voxel comparison of the dose of two results on the same grid. Difference, ratio and
+// z-score maps are computed in one parallel pass together with organ sums for each chunk of the
+// volume. The z-score uses the variance of both results, voxels are assumed independent.
+class DoseComparison {
+public:
+    struct Organ {
+        std::string name;
+        std::uint64_t voxels = 0;
+        double mass = 0; // g
+        double dose = 0;
+        double referenceDose = 0;
+        double difference = 0;
+        double ratio = 0;
+        double zScore = 0;
+    };
+
+    // Returns nullptr if the results do not share dimensions and spacing or lacks dose. Doses are
+    // in stored units (mGy).
+    static std::shared_ptr<DoseComparison> compare(std::shared_ptr<const DataContainer> data, std::shared_ptr<const DataContainer> reference);
+
+    const std::vector<double>& difference() const { return m_difference; }
+    const std::vector<double>& ratio() const { return m_ratio; }
+    const std::vector<double>& zScore() const { return m_zscore; }
+    const std::vector<Organ>& organs() const { return m_organs; }
+
+private:
+    std::vector<double> m_difference;
+    std::vector<double> m_ratio;
+    std::vector<double> m_zscore;
+    std::vector<Organ> m_organs;
+};
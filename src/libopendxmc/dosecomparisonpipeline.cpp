@@ -0,0 +1,118 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dosecomparisonpipeline.hpp>
+#include <hdf5wrapper.hpp>
+
+DoseComparisonPipeline::DoseComparisonPipeline(QObject* parent)
+    : BasePipeline(parent)
+{
+}
+
+void DoseComparisonPipeline::updateImageData(std::shared_ptr<DataContainer> data)
+{
+    m_data = data;
+    // comparison maps are removed when a new dose is simulated, organ sums depend on air masking
+    const bool stale = m_data && (!m_data->hasImage(DataContainer::ImageType::DoseDifference) || m_data->isAirMasked() != m_comparedAirMasked);
+    if (m_reference && m_data && m_data->hasImage(DataContainer::ImageType::Dose) && stale)
+        compare();
+    else if (!m_data || !m_data->hasImage(DataContainer::ImageType::DoseDifference))
+        emit comparisonTableChanged(nullptr);
+}
+
+void DoseComparisonPipeline::setReference(QString path)
+{
+    emit dataProcessingStarted(ProgressWorkType::LoadingFile);
+    HDF5Wrapper file(path.toStdString(), HDF5Wrapper::FileOpenMode::ReadOnly);
+    auto reference = file.load();
+    emit dataProcessingFinished(ProgressWorkType::LoadingFile);
+
+    if (!reference || !reference->hasImage(DataContainer::ImageType::Dose)) {
+        emit errorMessage(tr("No dose found in ") + path);
+        return;
+    }
+    m_reference = reference;
+    emit referenceChanged(path);
+    compare();
+}
+
+void DoseComparisonPipeline::clearReference()
+{
+    m_reference = nullptr;
+    emit referenceChanged(QString {});
+    emit comparisonTableChanged(nullptr);
+    if (m_data && m_data->hasImage(DataContainer::ImageType::DoseDifference)) {
+        m_data->removeDoseComparisonImages();
+        emit imageDataChanged(m_data);
+    }
+}
+
+void DoseComparisonPipeline::compare()
+{
+    if (!m_data || !m_reference)
+        return;
+
+    emit dataProcessingStarted(ProgressWorkType::Arbitrary);
+    auto comparison = DoseComparison::compare(m_data, m_reference);
+    m_comparedAirMasked = m_data->isAirMasked();
+    if (comparison) {
+        m_data->setImageArray(DataContainer::ImageType::DoseDifference, comparison->difference());
+        m_data->setImageArray(DataContainer::ImageType::DoseRatio, comparison->ratio());
+        if (comparison->zScore().empty())
+            m_data->removeImage(DataContainer::ImageType::DoseZScore);
+        else
+            m_data->setImageArray(DataContainer::ImageType::DoseZScore, comparison->zScore());
+    }
+    emit dataProcessingFinished(ProgressWorkType::Arbitrary);
+
+    if (!comparison) {
+        emit errorMessage(tr("Reference must have dose on the same image grid"));
+        emit comparisonTableChanged(nullptr);
+        return;
+    }
+    emit comparisonTableChanged(tableFromComparison(comparison, *m_data));
+    emit imageDataChanged(m_data);
+}
+
+std::shared_ptr<const DoseTable> DoseComparisonPipeline::tableFromComparison(std::shared_ptr<const DoseComparison> comparison, const DataContainer& data) const
+{
+    auto table = std::make_shared<DoseTable>();
+    auto& header = table->header;
+    const auto units = QString::fromStdString(data.units(DataContainer::ImageType::Dose));
+    const auto scale = data.displayScale(DataContainer::ImageType::Dose);
+    header.append(QString(tr("Name")));
+    header.append(QString(tr("Mass g")));
+    header.append(QString(tr("Dose ")) + units);
+    header.append(QString(tr("Reference dose ")) + units);
+    header.append(QString(tr("Difference ")) + units);
+    header.append(QString(tr("Ratio")));
+    header.append(QString(tr("z-score")));
+
+    for (const auto& organ : comparison->organs()) {
+        QVariantList row;
+        row.append(QString::fromStdString(organ.name));
+        row.append(organ.mass);
+        row.append(organ.dose * scale);
+        row.append(organ.referenceDose * scale);
+        row.append(organ.difference * scale);
+        row.append(organ.ratio);
+        row.append(organ.zScore);
+        table->rows.push_back(row);
+    }
+    return table;
+}
@@ -0,0 +1,52 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <basepipeline.hpp>
+#include <datacontainer.hpp>
+#include <dosecomparison.hpp>
+#include <dosetable.hpp>
+
+#include <QString>
+
+#include <memory>
+
+class DoseComparisonPipeline : public BasePipeline {
+    Q_OBJECT
+public:
+    DoseComparisonPipeline(QObject* parent = nullptr);
+    void updateImageData(std::shared_ptr<DataContainer>) override;
+    // Loads a saved result as reference, current dose is compared to it until cleared
+    void setReference(QString path);
+    void clearReference();
+
+signals:
+    void comparisonTableChanged(std::shared_ptr<const DoseTable>);
+    void referenceChanged(QString path);
+    void errorMessage(QString);
+
+protected:
+    void compare();
+    std::shared_ptr<const DoseTable> tableFromComparison(std::shared_ptr<const DoseComparison> comparison, const DataContainer& data) const;
+
+private:
+    std::shared_ptr<DataContainer> m_data = nullptr;
+    std::shared_ptr<DataContainer> m_reference = nullptr;
+    bool m_comparedAirMasked = false;
+};
@@ -0,0 +1,84 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dosecomparisonwidget.hpp>
+#include <dosetablewidget.hpp>
+
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSettings>
+#include <QVBoxLayout>
+
+DoseComparisonWidget::DoseComparisonWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    auto layout = new QVBoxLayout;
+    setLayout(layout);
+
+    auto controls = new QHBoxLayout;
+    auto load_button = new QPushButton(tr("Select reference"), this);
+    connect(load_button, &QPushButton::clicked, [this]() {
+        QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+        auto dirpath_str = settings.value("saveload/path", ".").value<QString>();
+        auto filename = QFileDialog::getOpenFileName(this, tr("Open reference simulation"), dirpath_str, tr("HDF5 (*.h5)"));
+        if (!filename.isEmpty()) {
+            settings.setValue("saveload/path", QFileInfo(filename).absolutePath());
+            m_messageLabel->clear();
+            emit requestSetReference(filename);
+        }
+    });
+    controls->addWidget(load_button);
+    auto clear_button = new QPushButton(tr("Clear reference"), this);
+    connect(clear_button, &QPushButton::clicked, [this]() {
+        m_messageLabel->clear();
+        emit requestClearReference();
+    });
+    controls->addWidget(clear_button);
+    m_referenceLabel = new QLabel(tr("No reference selected"), this);
+    controls->addWidget(m_referenceLabel);
+    controls->addStretch(100);
+    layout->addLayout(controls);
+
+    m_messageLabel = new QLabel(this);
+    layout->addWidget(m_messageLabel);
+
+    m_table = new DoseTableWidget(this);
+    layout->addWidget(m_table);
+}
+
+void DoseComparisonWidget::setComparisonTable(std::shared_ptr<const DoseTable> table)
+{
+    m_table->setDoseTable(table);
+}
+
+void DoseComparisonWidget::setReference(QString path)
+{
+    if (path.isEmpty())
+        m_referenceLabel->setText(tr("No reference selected"));
+    else
+        m_referenceLabel->setText(tr("Reference: ") + QDir::toNativeSeparators(path));
+}
+
+void DoseComparisonWidget::setMessage(QString message)
+{
+    m_messageLabel->setText(message);
+}
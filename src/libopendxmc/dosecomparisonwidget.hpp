@@ -0,0 +1,49 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <dosetable.hpp>
+
+#include <QString>
+#include <QWidget>
+
+#include <memory>
+
+class QLabel;
+class DoseTableWidget;
+
+// Selects a saved result as reference for dose comparison and shows organ summary statistics,
+// difference, ratio and z-score maps are shown in the image viewers
+class DoseComparisonWidget : public QWidget {
+    Q_OBJECT
+public:
+    DoseComparisonWidget(QWidget* parent = nullptr);
+    void setComparisonTable(std::shared_ptr<const DoseTable> table);
+    void setReference(QString path);
+    void setMessage(QString message);
+
+signals:
+    void requestSetReference(QString path);
+    void requestClearReference();
+
+private:
+    QLabel* m_referenceLabel = nullptr;
+    QLabel* m_messageLabel = nullptr;
+    DoseTableWidget* m_table = nullptr;
+};
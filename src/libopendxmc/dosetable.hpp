@@ -0,0 +1,36 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <QMetaType>
+#include <QStringList>
+#include <QVariant>
+
+#include <memory>
+#include <vector>
+
+// Organ dose table built by DoseTablePipeline and handed to DoseTableWidget in one piece, the
+// table is not modified after it is emitted.
+struct DoseTable {
+    QStringList header;
+    std::vector<QVariantList> rows;
+};
+
+// Allow std::shared_ptr<const DoseTable> to be used in signal/slots
+Q_DECLARE_METATYPE(std::shared_ptr<const DoseTable>)
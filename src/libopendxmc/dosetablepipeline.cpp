@@ -17,8 +17,16 @@ Copyright 2023 Erlend Andersen
 */
 
 #include <dosetablepipeline.hpp>
+#include <organaccumulator.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <execution>
+#include <numeric>
 #include <ranges>
+#include <thread>
+#include <vector>
 
 DoseTablePipeline::DoseTablePipeline(QObject* parent)
     : BasePipeline(parent)
@@ -28,60 +36,140 @@ DoseTablePipeline::DoseTablePipeline(QObject* parent)
 void DoseTablePipeline::clearDoseTable(bool clear)
 {
     if (clear)
-        emit clearTable();
+        emit doseTableChanged(nullptr);
 }
 
 void DoseTablePipeline::updateImageData(std::shared_ptr<DataContainer> data)
 {
-    emit clearTable();
-    if (!data)
+    if (!data) {
+        emit doseTableChanged(nullptr);
         return;
+    }
+    if (data->hasSweepResults()) {
+        emit doseTableChanged(tableFromSweepResults(data));
+        return;
+    }
+    if (!data->hasImage(DataContainer::ImageType::Dose) && data->hasOrganDoses()) {
+        emit doseTableChanged(tableFromOrganDoses(data));
+        return;
+    }
     if (!data->hasImage(DataContainer::ImageType::Organ) || !data->hasImage(DataContainer::ImageType::Dose)) {
+        emit doseTableChanged(nullptr);
         return;
     }
 
-    emit enableSorting(false);
-
-    QStringList header;
+    auto table = std::make_shared<DoseTable>();
+    auto& header = table->header;
     header.append(QString(tr("Name")));
     header.append(QString(tr("# Voxels")));
     header.append(QString(tr("Volume cm3")));
     header.append(QString(tr("Mass g")));
     auto units = QString::fromStdString(data->units(DataContainer::ImageType::Dose));
     header.append(QString(tr("Dose ")) + units);
+    const bool hasVariance = data->hasImage(DataContainer::ImageType::DoseVariance);
+    if (hasVariance) {
+        header.append(QString(tr("Std. error ")) + units);
+        header.append(QString(tr("Rel. error %")));
+    }
 
-    emit doseDataHeader(header);
-
-    const auto& organArray = data->getOrganArray();
     const auto& organNames = data->getOrganNames();
+    const auto voxelVolume = std::reduce(data->spacing().cbegin(), data->spacing().cend(), 1.0, std::multiplies {});
+    const std::vector<std::uint8_t> noMask;
+    const auto& airMask = data->isAirMasked() ? data->airMask() : noMask;
     const auto& doseArray = data->getDoseArray();
-    const auto& densityArray = data->getDensityArray();
+    const auto& varianceArray = data->getDoseVarianceArray();
+    const bool varianceScored = varianceArray.size() == doseArray.size();
+    const auto organs = accumulateOrgans(data->getOrganArray(), data->getDensityArray(), voxelVolume, airMask, [&](const std::size_t i) {
+        const auto d = data->doseIndex(i);
+        return VoxelDose { .dose = doseArray[d], .variance = varianceScored ? varianceArray[d] : 0.0 };
+    });
+    const auto scale = data->displayScale(DataContainer::ImageType::Dose);
+
+    for (std::size_t i = 0; i < std::min(organNames.size(), organs.size()); ++i) {
+        const auto& organ = organs[i];
+        if (organ.voxels > 0) {
+            QVariantList row;
+            row.append(QString::fromStdString(organNames[i]));
+            row.append(static_cast<int>(organ.voxels));
+            row.append(organ.voxels * voxelVolume);
+            row.append(organ.mass);
+            const auto dose = scale * organ.energy / organ.mass;
+            row.append(dose);
+            if (hasVariance)
+                appendUncertainty(row, dose, scale * scale * organ.variance / (organ.mass * organ.mass));
+            table->rows.push_back(row);
+        }
+    }
+    emit doseTableChanged(table);
+}
 
-    const auto voxelVolume = std::reduce(data->spacing().cbegin(), data->spacing().cend(), 1.0, std::multiplies {});
-    std::vector<double> energy_imparted(doseArray.size());
-    std::transform(std::execution::par_unseq, doseArray.cbegin(), doseArray.cend(), densityArray.cbegin(), energy_imparted.begin(),
-        [=](const auto& dose, const auto& dens) {
-            const auto mass = voxelVolume * dens;
-            return dose * mass;
-        });
-
-    for (std::uint8_t i = 0; i < organNames.size(); ++i) {
-        const auto Nvoxels = std::count(std::execution::par_unseq, organArray.cbegin(), organArray.cend(), i);
-        if (Nvoxels > 0) {
-            const double energy = std::transform_reduce(std::execution::par_unseq, energy_imparted.cbegin(), energy_imparted.cend(), organArray.cbegin(), 0.0, std::plus {},
-                [=](const auto& d, const auto& o) {
-                    return o == i ? d : 0.0;
-                });
-            const double mass = voxelVolume * std::transform_reduce(std::execution::par_unseq, densityArray.cbegin(), densityArray.cend(), organArray.cbegin(), 0.0, std::plus {}, [=](const auto& d, const auto& o) {
-                return o == i ? d : 0.0;
-            });
-
-            emit doseData(0, i, QVariant { QString::fromStdString(organNames[i]) });
-            emit doseData(1, i, QVariant { static_cast<int>(Nvoxels) });
-            emit doseData(2, i, QVariant { Nvoxels * voxelVolume });
-            emit doseData(3, i, QVariant { mass });
-            emit doseData(4, i, QVariant { energy / mass });
+void DoseTablePipeline::appendUncertainty(QVariantList& row, double dose, double variance)
+{
+    const auto stderror = std::sqrt(std::max(variance, 0.0));
+    row.append(stderror);
+    row.append(dose > 0 ? 100 * stderror / dose : 0.0);
+}
+
+std::shared_ptr<const DoseTable> DoseTablePipeline::tableFromOrganDoses(std::shared_ptr<DataContainer> data)
+{
+    auto table = std::make_shared<DoseTable>();
+    auto& header = table->header;
+    header.append(QString(tr("Name")));
+    header.append(QString(tr("# Voxels")));
+    header.append(QString(tr("Volume cm3")));
+    header.append(QString(tr("Mass g")));
+    auto units = QString::fromStdString(data->units(DataContainer::ImageType::Dose));
+    header.append(QString(tr("Dose ")) + units);
+    header.append(QString(tr("Std. error ")) + units);
+    header.append(QString(tr("Rel. error %")));
+
+    const auto scale = data->displayScale(DataContainer::ImageType::Dose);
+    for (const auto& organ : data->getOrganDoses()) {
+        QVariantList row;
+        row.append(QString::fromStdString(organ.name));
+        row.append(static_cast<int>(organ.voxels));
+        row.append(organ.volume);
+        row.append(organ.mass);
+        row.append(organ.dose * scale);
+        appendUncertainty(row, organ.dose * scale, organ.variance * scale * scale);
+        table->rows.push_back(row);
+    }
+    return table;
+}
+
+std::shared_ptr<const DoseTable> DoseTablePipeline::tableFromSweepResults(std::shared_ptr<DataContainer> data)
+{
+    const auto& results = data->getSweepResults();
+    auto units = QString::fromStdString(data->units(DataContainer::ImageType::Dose));
+    const auto scale = data->displayScale(DataContainer::ImageType::Dose);
+
+    auto table = std::make_shared<DoseTable>();
+    auto& header = table->header;
+    header.append(QString(tr("Name")));
+    header.append(QString(tr("Volume cm3")));
+    header.append(QString(tr("Mass g")));
+    for (const auto& variant : results)
+        header.append(QString(tr("Dose ")) + units + QString(" ") + QString::fromStdString(variant.name));
+
+    // Rows are matched by organ name since phantoms of a batch simulation have different labels,
+    // volume and mass are taken from the first result containing the organ
+    std::vector<const DataContainer::OrganDose*> rows;
+    for (const auto& variant : results)
+        for (const auto& organ : variant.doses)
+            if (std::none_of(rows.cbegin(), rows.cend(), [&](const auto* r) { return r->name == organ.name; }))
+                rows.push_back(&organ);
+
+    for (const auto* organ : rows) {
+        QVariantList row;
+        row.append(QString::fromStdString(organ->name));
+        row.append(organ->volume);
+        row.append(organ->mass);
+        for (const auto& variant : results) {
+            const auto& doses = variant.doses;
+            auto dose = std::find_if(doses.cbegin(), doses.cend(), [&](const auto& d) { return d.name == organ->name; });
+            row.append(dose != doses.cend() ? QVariant { dose->dose * scale } : QVariant {});
         }
+        table->rows.push_back(row);
     }
-    emit enableSorting(true);
+    return table;
 }
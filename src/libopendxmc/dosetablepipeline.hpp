@@ -20,9 +20,12 @@ Copyright 2023 Erlend Andersen
 
 #include <basepipeline.hpp>
 #include <datacontainer.hpp>
+#include <dosetable.hpp>
 
 #include <QVariant>
 
+#include <memory>
+
 class DoseTablePipeline : public BasePipeline {
     Q_OBJECT
 public:
@@ -31,8 +34,12 @@ public:
     void updateImageData(std::shared_ptr<DataContainer>);
 
 signals:
-    void clearTable();
-    void enableSorting(bool);
-    void doseData(int col, int row, QVariant data);
-    void doseDataHeader(QStringList);
-};
\ No newline at end of file
+    // Complete table, nullptr clears the table
+    void doseTableChanged(std::shared_ptr<const DoseTable>);
+
+protected:
+    std::shared_ptr<const DoseTable> tableFromOrganDoses(std::shared_ptr<DataContainer> data);
+    std::shared_ptr<const DoseTable> tableFromSweepResults(std::shared_ptr<DataContainer> data);
+    // Standard error and relative error in percent
+    static void appendUncertainty(QVariantList& row, double dose, double variance);
+};
@@ -20,46 +20,73 @@ Copyright 2023 Erlend Andersen
 
 #include <QApplication>
 #include <QClipboard>
+#include <QItemSelectionModel>
 #include <QKeyEvent>
 #include <QList>
+#include <QSortFilterProxyModel>
 #include <QStringList>
-#include <QTableWidgetItem>
 
-DoseTableWidget::DoseTableWidget(QWidget* parent)
-    : QTableWidget(parent)
+#include <algorithm>
+
+DoseTableModel::DoseTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
 {
-    setSortingEnabled(true);
 }
 
-void DoseTableWidget::enableSorting(bool on)
+void DoseTableModel::setDoseTable(std::shared_ptr<const DoseTable> table)
 {
-    setSortingEnabled(on);
+    beginResetModel();
+    m_table = table;
+    endResetModel();
 }
 
-void DoseTableWidget::setDoseDataHeader(QStringList header)
+int DoseTableModel::rowCount(const QModelIndex& parent) const
 {
-    if (columnCount() < header.size()) {
-        setColumnCount(header.size());
-    }
-    setHorizontalHeaderLabels(header);
+    if (parent.isValid() || !m_table)
+        return 0;
+    return static_cast<int>(m_table->rows.size());
 }
 
-void DoseTableWidget::setDoseData(int col, int row, QVariant data)
+int DoseTableModel::columnCount(const QModelIndex& parent) const
 {
-    if (columnCount() <= col) {
-        setColumnCount(col + 1);
-    }
-    if (rowCount() <= row) {
-        setRowCount(row + 1);
-    }
+    if (parent.isValid() || !m_table)
+        return 0;
+    return static_cast<int>(m_table->header.size());
+}
 
-    if (auto citem = item(row, col); citem) {
-        citem->setData(Qt::DisplayRole, data);
-    } else {
-        auto nitem = new QTableWidgetItem();
-        nitem->setData(Qt::DisplayRole, data);
-        setItem(row, col, nitem);
-    }
+QVariant DoseTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!m_table || !index.isValid() || role != Qt::DisplayRole)
+        return QVariant {};
+    const auto& row = m_table->rows[index.row()];
+    return index.column() < row.size() ? row[index.column()] : QVariant {};
+}
+
+QVariant DoseTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant {};
+    if (orientation == Qt::Horizontal)
+        return m_table && section < m_table->header.size() ? QVariant { m_table->header[section] } : QVariant {};
+    return QVariant { section + 1 };
+}
+
+DoseTableWidget::DoseTableWidget(QWidget* parent)
+    : QTableView(parent)
+{
+    m_model = new DoseTableModel(this);
+    m_proxy = new QSortFilterProxyModel(this);
+    m_proxy->setSourceModel(m_model);
+    setModel(m_proxy);
+    setSortingEnabled(true);
+}
+
+void DoseTableWidget::setDoseTable(std::shared_ptr<const DoseTable> table)
+{
+    // sorting is turned off while the model is swapped and applied once afterwards
+    setSortingEnabled(false);
+    m_model->setDoseTable(table);
+    setSortingEnabled(true);
 }
 
 void DoseTableWidget::keyPressEvent(QKeyEvent* event)
@@ -67,47 +94,45 @@ void DoseTableWidget::keyPressEvent(QKeyEvent* event)
     if (event->matches(QKeySequence::Copy)) {
         copyToClipBoard();
     } else {
-        QTableWidget::keyPressEvent(event);
+        QTableView::keyPressEvent(event);
     }
 }
 
 void DoseTableWidget::copyToClipBoard()
 {
-
-    auto sItems = selectedItems();
+    const auto indexes = selectionModel()->selectedIndexes();
+    if (indexes.isEmpty())
+        return;
 
     int max_row = 0;
     int max_col = 0;
-    for (auto& s : sItems) {
-        max_row = std::max(max_row, s->row());
-        max_col = std::max(max_col, s->column());
+    for (const auto& idx : indexes) {
+        max_row = std::max(max_row, idx.row());
+        max_col = std::max(max_col, idx.column());
     }
     int min_row = max_row;
     int min_col = max_col;
-    for (auto& s : sItems) {
-        min_row = std::min(min_row, s->row());
-        min_col = std::min(min_col, s->column());
+    for (const auto& idx : indexes) {
+        min_row = std::min(min_row, idx.row());
+        min_col = std::min(min_col, idx.column());
     }
 
     QList<QStringList> data;
     data.resize(max_row - min_row + 1);
 
-    for (auto item : sItems) {
-        auto r = item->row() - min_row;
-        auto c = item->column() - min_col;
+    for (const auto& idx : indexes) {
+        auto r = idx.row() - min_row;
+        auto c = idx.column() - min_col;
         if (data[r].size() <= c)
             data[r].resize(c + 1);
-        data[r][c] = item->data(Qt::DisplayRole).toString();
+        data[r][c] = idx.data(Qt::DisplayRole).toString();
     }
 
     QString clipboardString;
 
     QStringList header(max_col - min_col + 1);
-    for (int col = min_col; col <= max_col; col++) {
-        auto hitem = horizontalHeaderItem(col);
-        if (hitem)
-            header[col - min_col] = hitem->data(Qt::DisplayRole).toString();
-    }
+    for (int col = min_col; col <= max_col; col++)
+        header[col - min_col] = model()->headerData(col, Qt::Horizontal, Qt::DisplayRole).toString();
     clipboardString.append(header.join("\t"));
     clipboardString.append("\n");
 
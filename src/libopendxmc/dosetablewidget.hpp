@@ -18,18 +18,42 @@ Copyright 2023 Erlend Andersen
 
 #pragma once
 
-#include <QTableWidget>
+#include <dosetable.hpp>
+
+#include <QAbstractTableModel>
+#include <QTableView>
 #include <QVariant>
 
-class DoseTableWidget : public QTableWidget {
+#include <memory>
+
+class QSortFilterProxyModel;
+
+// Read only model of an immutable dose table, the table is swapped in one model reset
+class DoseTableModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    DoseTableModel(QObject* parent = nullptr);
+    void setDoseTable(std::shared_ptr<const DoseTable> table);
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    std::shared_ptr<const DoseTable> m_table = nullptr;
+};
+
+class DoseTableWidget : public QTableView {
     Q_OBJECT
 public:
     DoseTableWidget(QWidget* parent = nullptr);
-    void setDoseData(int col, int row, QVariant);
-    void setDoseDataHeader(QStringList header);
-    void enableSorting(bool on);
+    void setDoseTable(std::shared_ptr<const DoseTable> table);
     void keyPressEvent(QKeyEvent* event);
 
 protected:
     void copyToClipBoard();
-};
\ No newline at end of file
+
+private:
+    DoseTableModel* m_model = nullptr;
+    QSortFilterProxyModel* m_proxy = nullptr;
+};
@@ -0,0 +1,154 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dosevolumehistogram.hpp>
+#include <organaccumulator.hpp>
+
+#include <algorithm>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+std::shared_ptr<DoseVolumeHistogram> DoseVolumeHistogram::compute(std::shared_ptr<DataContainer> data, std::size_t nbins)
+{
+    if (!data || nbins == 0)
+        return nullptr;
+    if (!data->hasImage(DataContainer::ImageType::Dose) || !data->hasImage(DataContainer::ImageType::Organ) || !data->hasImage(DataContainer::ImageType::Density))
+        return nullptr;
+
+    const auto& doseArray = data->getDoseArray();
+    const auto& organArray = data->getOrganArray();
+    const auto& densityArray = data->getDensityArray();
+    const auto& organNames = data->getOrganNames();
+    const auto norgans = std::min(organNames.size(), std::size_t { 256 });
+    if (norgans == 0)
+        return nullptr;
+
+    // dose is zero in air if air dose is masked
+    const bool masked = data->isAirMasked();
+    const auto& airMask = data->airMask();
+    const auto voxelDose = [&](const std::size_t i) { return masked && airMask[i] ? 0.0 : doseArray[data->doseIndex(i)]; };
+    const auto max = [](const auto a, const auto b) { return std::max(a, b); };
+    const auto& doseAirMask = data->doseAirMask();
+    const auto maxDose = masked
+        ? std::transform_reduce(std::execution::par_unseq, doseArray.cbegin(), doseArray.cend(), doseAirMask.cbegin(), 0.0, max, [](const auto d, const auto air) { return air ? 0.0 : d; })
+        : std::reduce(std::execution::par_unseq, doseArray.cbegin(), doseArray.cend(), 0.0, max);
+    const auto binWidth = maxDose > 0 ? maxDose / nbins : 1.0;
+    const auto voxelVolume = std::reduce(data->spacing().cbegin(), data->spacing().cend(), 1.0, std::multiplies {});
+
+    // voxel count, mass and mean dose for each organ
+    const std::vector<std::uint8_t> noMask;
+    const auto organSums = accumulateOrgans(organArray, densityArray, voxelVolume, masked ? airMask : noMask, [&](const std::size_t i) {
+        return VoxelDose { .dose = doseArray[data->doseIndex(i)] };
+    });
+
+    // Histogram of each chunk, voxel count and mass for each organ and bin followed by max dose
+    // for each organ
+    struct Histogram {
+        std::vector<std::uint64_t> count;
+        std::vector<double> mass;
+        std::vector<double> max;
+    };
+    const auto N = organArray.size();
+    const auto nchunks = std::clamp(static_cast<std::size_t>(std::thread::hardware_concurrency()), std::size_t { 1 }, std::max(N, std::size_t { 1 }));
+    std::vector<Histogram> histograms(nchunks);
+    std::vector<std::size_t> chunks(nchunks);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    std::for_each(std::execution::par, chunks.cbegin(), chunks.cend(), [&](const std::size_t c) {
+        auto& h = histograms[c];
+        h.count.resize(norgans * nbins, 0);
+        h.mass.resize(norgans * nbins, 0);
+        h.max.resize(norgans, 0);
+        const auto start = (N * c) / nchunks;
+        const auto stop = (N * (c + 1)) / nchunks;
+        for (std::size_t i = start; i < stop; ++i) {
+            const std::size_t o = organArray[i];
+            if (o >= norgans)
+                continue;
+            const auto dose = voxelDose(i);
+            const auto bin = std::min(static_cast<std::size_t>(dose / binWidth), nbins - 1);
+            const auto mass = densityArray[i] * voxelVolume;
+            h.count[o * nbins + bin]++;
+            h.mass[o * nbins + bin] += mass;
+            h.max[o] = std::max(h.max[o], dose);
+        }
+    });
+
+    Histogram total { std::vector<std::uint64_t>(norgans * nbins, 0), std::vector<double>(norgans * nbins, 0), std::vector<double>(norgans, 0) };
+    for (const auto& h : histograms) {
+        std::transform(h.count.cbegin(), h.count.cend(), total.count.cbegin(), total.count.begin(), std::plus {});
+        std::transform(h.mass.cbegin(), h.mass.cend(), total.mass.cbegin(), total.mass.begin(), std::plus {});
+        std::transform(h.max.cbegin(), h.max.cend(), total.max.cbegin(), total.max.begin(), [](const auto a, const auto b) { return std::max(a, b); });
+    }
+
+    auto dvh = std::make_shared<DoseVolumeHistogram>();
+    dvh->m_dataID = data->ID();
+    dvh->m_units = data->units(DataContainer::ImageType::Dose);
+    // histograms are binned in stored units and labeled in display units
+    const auto scale = data->displayScale(DataContainer::ImageType::Dose);
+    dvh->m_dose.resize(nbins);
+    for (std::size_t b = 0; b < nbins; ++b)
+        dvh->m_dose[b] = b * binWidth * scale;
+
+    for (std::size_t o = 0; o < norgans; ++o) {
+        const auto count_begin = total.count.cbegin() + o * nbins;
+        const auto mass_begin = total.mass.cbegin() + o * nbins;
+        const auto& sums = organSums[o];
+        const auto voxels = sums.voxels;
+        if (voxels == 0)
+            continue;
+        Organ organ;
+        organ.name = organNames[o];
+        organ.voxels = voxels;
+        organ.mass = sums.mass;
+        organ.meanDose = organ.mass > 0 ? scale * sums.energy / organ.mass : 0.0;
+        organ.maxDose = scale * total.max[o];
+        organ.volume.resize(nbins);
+        organ.massFraction.resize(nbins);
+        // cumulative from highest dose bin
+        std::uint64_t count_sum = 0;
+        double mass_sum = 0;
+        for (std::size_t b = nbins; b-- > 0;) {
+            count_sum += *(count_begin + b);
+            mass_sum += *(mass_begin + b);
+            organ.volume[b] = static_cast<double>(count_sum) / voxels;
+            organ.massFraction[b] = organ.mass > 0 ? mass_sum / organ.mass : 0.0;
+        }
+        dvh->m_organs.push_back(std::move(organ));
+    }
+    return dvh;
+}
+
+bool DoseVolumeHistogram::saveCSV(const std::string& path, bool massWeighted) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+    file << "Dose " << m_units;
+    for (const auto& organ : m_organs)
+        file << ",\"" << organ.name << "\"";
+    file << '\n';
+    for (std::size_t b = 0; b < m_dose.size(); ++b) {
+        file << m_dose[b];
+        for (const auto& organ : m_organs)
+            file << ',' << (massWeighted ? organ.massFraction[b] : organ.volume[b]);
+        file << '\n';
+    }
+    return file.good();
+}
@@ -0,0 +1,63 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <datacontainer.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cumulative dose volume histograms for each organ, computed from the dose, organ and density
+// arrays in one parallel pass with a fixed bin histogram for each chunk of the volume. Bins are
+// equally spaced from zero to maximum dose. Both volume and mass weighted histograms are kept.
+class DoseVolumeHistogram {
+public:
+    struct Organ {
+        std::string name;
+        std::uint64_t voxels = 0;
+        double mass = 0; // g
+        double meanDose = 0;
+        double maxDose = 0;
+        std::vector<double> volume; // fraction of organ volume receiving at least dose of bin
+        std::vector<double> massFraction; // fraction of organ mass receiving at least dose of bin
+    };
+
+    static std::shared_ptr<DoseVolumeHistogram> compute(std::shared_ptr<DataContainer> data, std::size_t nbins = 200);
+
+    // ID of the data container the histograms were computed from, changes when dose is replaced
+    std::uint64_t dataID() const { return m_dataID; }
+    const std::string& units() const { return m_units; }
+    // Lower dose of each bin
+    const std::vector<double>& dose() const { return m_dose; }
+    const std::vector<Organ>& organs() const { return m_organs; }
+
+    // Comma separated values with one column for each organ
+    bool saveCSV(const std::string& path, bool massWeighted = false) const;
+
+private:
+    std::uint64_t m_dataID = 0;
+    std::string m_units;
+    std::vector<double> m_dose;
+    std::vector<Organ> m_organs;
+};
+
+// Allow std::shared_ptr<DoseVolumeHistogram> to be used in signal/slots
+Q_DECLARE_METATYPE(std::shared_ptr<DoseVolumeHistogram>)
@@ -0,0 +1,60 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dvhpipeline.hpp>
+
+DVHPipeline::DVHPipeline(QObject* parent)
+    : BasePipeline(parent)
+{
+}
+
+void DVHPipeline::updateImageData(std::shared_ptr<DataContainer> data)
+{
+    if (!data || !data->hasImage(DataContainer::ImageType::Dose) || !data->hasImage(DataContainer::ImageType::Organ)) {
+        m_current = nullptr;
+        emit dvhChanged(m_current);
+        return;
+    }
+    if (auto it = m_cache.find(data->ID()); it != m_cache.end()) {
+        if (m_current != it->second) {
+            m_current = it->second;
+            emit dvhChanged(m_current);
+        }
+        return;
+    }
+
+    emit dataProcessingStarted(ProgressWorkType::Arbitrary);
+    m_current = DoseVolumeHistogram::compute(data);
+    if (m_current) {
+        // IDs are increasing, we keep the most recent
+        constexpr std::size_t maxCached = 8;
+        m_cache[data->ID()] = m_current;
+        while (m_cache.size() > maxCached)
+            m_cache.erase(m_cache.begin());
+    }
+    emit dvhChanged(m_current);
+    emit dataProcessingFinished(ProgressWorkType::Arbitrary);
+}
+
+void DVHPipeline::exportCSV(QString path, bool massWeighted)
+{
+    if (!m_current)
+        return;
+    if (!m_current->saveCSV(path.toStdString(), massWeighted))
+        emit errorMessage(tr("Could not write dose volume histograms to ") + path);
+}
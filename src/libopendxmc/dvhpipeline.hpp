@@ -0,0 +1,46 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <basepipeline.hpp>
+#include <datacontainer.hpp>
+#include <dosevolumehistogram.hpp>
+
+#include <QString>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+class DVHPipeline : public BasePipeline {
+    Q_OBJECT
+public:
+    DVHPipeline(QObject* parent = nullptr);
+    void updateImageData(std::shared_ptr<DataContainer>) override;
+    void exportCSV(QString path, bool massWeighted);
+
+signals:
+    void dvhChanged(std::shared_ptr<DoseVolumeHistogram>);
+    void errorMessage(QString);
+
+private:
+    std::shared_ptr<DoseVolumeHistogram> m_current = nullptr;
+    // Histograms by data ID, a new ID is generated when dose is replaced
+    std::map<std::uint64_t, std::shared_ptr<DoseVolumeHistogram>> m_cache;
+};
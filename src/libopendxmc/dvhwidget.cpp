@@ -0,0 +1,168 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dvhwidget.hpp>
+
+#include <QChart>
+#include <QChartView>
+#include <QComboBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QGraphicsLayout>
+#include <QGuiApplication>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineSeries>
+#include <QListWidget>
+#include <QPushButton>
+#include <QSettings>
+#include <QSignalBlocker>
+#include <QStyleHints>
+#include <QVBoxLayout>
+#include <QValueAxis>
+
+#include <algorithm>
+#include <numeric>
+
+DVHWidget::DVHWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    auto layout = new QVBoxLayout;
+    setLayout(layout);
+
+    auto controls = new QHBoxLayout;
+    m_weighting = new QComboBox(this);
+    m_weighting->addItem(tr("Volume weighted"));
+    m_weighting->addItem(tr("Mass weighted"));
+    connect(m_weighting, &QComboBox::currentIndexChanged, [this](int) { updateChart(); });
+    controls->addWidget(m_weighting);
+    auto export_button = new QPushButton(tr("Export CSV"), this);
+    connect(export_button, &QPushButton::clicked, [this]() {
+        if (!m_dvh)
+            return;
+        QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+        auto dirpath_str = settings.value("saveload/path", ".").value<QString>();
+        QDir dirpath(dirpath_str);
+        auto filename = QFileDialog::getSaveFileName(this, tr("Save File"), dirpath.absoluteFilePath("dvh.csv"), tr("Comma separated values (*.csv)"));
+        if (!filename.isEmpty()) {
+            settings.setValue("saveload/path", QFileInfo(filename).absolutePath());
+            m_messageLabel->clear();
+            emit requestExportCSV(filename, m_weighting->currentIndex() == 1);
+        }
+    });
+    controls->addWidget(export_button);
+    controls->addStretch(100);
+    layout->addLayout(controls);
+
+    m_messageLabel = new QLabel(this);
+    layout->addWidget(m_messageLabel);
+
+    auto content = new QHBoxLayout;
+    m_chartView = new QChartView(this);
+    m_chartView->setRenderHint(QPainter::Antialiasing, true);
+    auto chart = m_chartView->chart();
+    chart->layout()->setContentsMargins(0, 0, 0, 0);
+    if (QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Dark) {
+        chart->setTheme(QChart::ChartThemeDark);
+    }
+    chart->setBackgroundVisible(false);
+    chart->setMargins(QMargins { 0, 0, 0, 0 });
+    m_xaxis = new QValueAxis(chart);
+    chart->addAxis(m_xaxis, Qt::AlignBottom);
+    m_yaxis = new QValueAxis(chart);
+    m_yaxis->setRange(0, 100);
+    m_yaxis->setTitleText(tr("Volume %"));
+    chart->addAxis(m_yaxis, Qt::AlignLeft);
+    content->addWidget(m_chartView, 3);
+
+    m_organList = new QListWidget(this);
+    connect(m_organList, &QListWidget::itemChanged, [this](QListWidgetItem*) { updateChart(); });
+    content->addWidget(m_organList, 1);
+    layout->addLayout(content);
+}
+
+void DVHWidget::setDVH(std::shared_ptr<DoseVolumeHistogram> dvh)
+{
+    // keep selected organs when histograms are updated
+    QStringList selected;
+    for (int i = 0; i < m_organList->count(); ++i)
+        if (m_organList->item(i)->checkState() == Qt::Checked)
+            selected.append(m_organList->item(i)->text());
+
+    m_dvh = dvh;
+    {
+        const QSignalBlocker blocker(m_organList);
+        m_organList->clear();
+        if (m_dvh) {
+            const auto& organs = m_dvh->organs();
+            // organs with highest mean dose are shown if none of the selected organs are present
+            std::vector<std::size_t> order(organs.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](auto a, auto b) { return organs[a].meanDose > organs[b].meanDose; });
+            const bool keepSelection = std::any_of(organs.cbegin(), organs.cend(), [&](const auto& o) { return selected.contains(QString::fromStdString(o.name)); });
+            for (std::size_t i = 0; i < organs.size(); ++i) {
+                const auto name = QString::fromStdString(organs[i].name);
+                auto item = new QListWidgetItem(name, m_organList);
+                item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+                const auto rank = std::distance(order.cbegin(), std::find(order.cbegin(), order.cend(), i));
+                const bool checked = keepSelection ? selected.contains(name) : rank < 5;
+                item->setCheckState(checked ? Qt::Checked : Qt::Unchecked);
+            }
+        }
+    }
+    updateChart();
+}
+
+void DVHWidget::setMessage(QString message)
+{
+    m_messageLabel->setText(message);
+}
+
+void DVHWidget::updateChart()
+{
+    auto chart = m_chartView->chart();
+    chart->removeAllSeries();
+    if (!m_dvh || m_dvh->dose().empty())
+        return;
+
+    const bool massWeighted = m_weighting->currentIndex() == 1;
+    m_yaxis->setTitleText(massWeighted ? tr("Mass %") : tr("Volume %"));
+    m_xaxis->setTitleText(tr("Dose ") + QString::fromStdString(m_dvh->units()));
+
+    const auto& dose = m_dvh->dose();
+    const auto& organs = m_dvh->organs();
+    double maxDose = 0;
+    for (int i = 0; i < m_organList->count(); ++i) {
+        if (m_organList->item(i)->checkState() != Qt::Checked || i >= organs.size())
+            continue;
+        const auto& organ = organs[i];
+        const auto& fraction = massWeighted ? organ.massFraction : organ.volume;
+        auto series = new QLineSeries(chart);
+        series->setName(QString::fromStdString(organ.name));
+        QList<QPointF> points(dose.size());
+        for (std::size_t b = 0; b < dose.size(); ++b)
+            points[b] = QPointF(dose[b], fraction[b] * 100);
+        series->append(points);
+        chart->addSeries(series);
+        series->attachAxis(m_xaxis);
+        series->attachAxis(m_yaxis);
+        maxDose = std::max(maxDose, organ.maxDose);
+    }
+    m_xaxis->setRange(0, maxDose > 0 ? maxDose : dose.back());
+}
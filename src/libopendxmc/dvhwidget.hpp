@@ -0,0 +1,55 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <dosevolumehistogram.hpp>
+
+#include <QWidget>
+
+#include <memory>
+
+class QChartView;
+class QComboBox;
+class QLabel;
+class QListWidget;
+class QValueAxis;
+
+// Chart of cumulative dose volume histograms for organs selected in a list
+class DVHWidget : public QWidget {
+    Q_OBJECT
+public:
+    DVHWidget(QWidget* parent = nullptr);
+    void setDVH(std::shared_ptr<DoseVolumeHistogram> dvh);
+    void setMessage(QString message);
+
+signals:
+    void requestExportCSV(QString path, bool massWeighted);
+
+protected:
+    void updateChart();
+
+private:
+    std::shared_ptr<DoseVolumeHistogram> m_dvh = nullptr;
+    QChartView* m_chartView = nullptr;
+    QValueAxis* m_xaxis = nullptr;
+    QValueAxis* m_yaxis = nullptr;
+    QComboBox* m_weighting = nullptr;
+    QListWidget* m_organList = nullptr;
+    QLabel* m_messageLabel = nullptr;
+};
@@ -0,0 +1,131 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// Tight bounding box of non air voxels (material index > 0). The voxel grid is built on the
+// cropped region and translated so that it occupies the same space as the full grid.
+class GridCrop {
+public:
+    GridCrop(const std::array<std::size_t, 3>& dim)
+        : m_dim(dim)
+        , m_cdim(dim)
+    {
+    }
+    GridCrop(const std::array<std::size_t, 3>& dim, const std::vector<std::uint8_t>& materialArray)
+        : m_dim(dim)
+        , m_cdim(dim)
+    {
+        // bounding box per z slice, then reduced
+        constexpr auto nmax = std::numeric_limits<std::size_t>::max();
+        std::vector<std::array<std::size_t, 4>> slices(m_dim[2], { nmax, nmax, 0, 0 });
+        std::vector<std::size_t> zslices(m_dim[2]);
+        std::iota(zslices.begin(), zslices.end(), 0);
+        std::for_each(std::execution::par_unseq, zslices.cbegin(), zslices.cend(), [&](const std::size_t z) {
+            auto& b = slices[z];
+            for (std::size_t y = 0; y < m_dim[1]; ++y) {
+                const auto offset = m_dim[0] * (y + m_dim[1] * z);
+                for (std::size_t x = 0; x < m_dim[0]; ++x) {
+                    if (materialArray[offset + x] > 0) {
+                        b[0] = std::min(b[0], x);
+                        b[1] = std::min(b[1], y);
+                        b[2] = std::max(b[2], x);
+                        b[3] = std::max(b[3], y);
+                    }
+                }
+            }
+        });
+
+        std::array<std::size_t, 3> lo = { nmax, nmax, nmax };
+        std::array<std::size_t, 3> hi = { 0, 0, 0 };
+        for (std::size_t z = 0; z < m_dim[2]; ++z) {
+            const auto& b = slices[z];
+            if (b[0] == nmax)
+                continue;
+            lo = { std::min(lo[0], b[0]), std::min(lo[1], b[1]), std::min(lo[2], z) };
+            hi = { std::max(hi[0], b[2]), std::max(hi[1], b[3]), std::max(hi[2], z) };
+        }
+        if (lo[0] == nmax)
+            return; // only air, we keep the full grid
+        m_lo = lo;
+        for (std::size_t i = 0; i < 3; ++i)
+            m_cdim[i] = hi[i] - lo[i] + 1;
+    }
+
+    bool isCropped() const
+    {
+        return m_cdim != m_dim;
+    }
+    const std::array<std::size_t, 3>& dimensions() const { return m_cdim; }
+    // Index of the first voxel of the cropped grid in the full grid
+    const std::array<std::size_t, 3>& lower() const { return m_lo; }
+    std::size_t size() const { return m_cdim[0] * m_cdim[1] * m_cdim[2]; }
+
+    // Translation of cropped grid center relative to full grid center
+    std::array<double, 3> offset(const std::array<double, 3>& spacing) const
+    {
+        std::array<double, 3> res;
+        for (std::size_t i = 0; i < 3; ++i)
+            res[i] = (2 * static_cast<double>(m_lo[i]) + static_cast<double>(m_cdim[i]) - static_cast<double>(m_dim[i])) * spacing[i] / 2;
+        return res;
+    }
+
+    template <typename T>
+    std::vector<T> crop(const std::vector<T>& full) const
+    {
+        std::vector<T> res(size());
+        std::vector<std::size_t> zslices(m_cdim[2]);
+        std::iota(zslices.begin(), zslices.end(), 0);
+        std::for_each(std::execution::par_unseq, zslices.cbegin(), zslices.cend(), [&](const std::size_t z) {
+            for (std::size_t y = 0; y < m_cdim[1]; ++y) {
+                const auto src = full.cbegin() + m_lo[0] + m_dim[0] * (y + m_lo[1] + m_dim[1] * (z + m_lo[2]));
+                std::copy(src, src + m_cdim[0], res.begin() + m_cdim[0] * (y + m_cdim[1] * z));
+            }
+        });
+        return res;
+    }
+
+    // Index in cropped grid of a voxel in the full grid, or size() if the voxel is outside
+    std::size_t gridIndex(std::size_t fullIdx) const
+    {
+        const auto x = fullIdx % m_dim[0];
+        const auto y = (fullIdx / m_dim[0]) % m_dim[1];
+        const auto z = fullIdx / (m_dim[0] * m_dim[1]);
+        if (x < m_lo[0] || y < m_lo[1] || z < m_lo[2])
+            return size();
+        const auto cx = x - m_lo[0];
+        const auto cy = y - m_lo[1];
+        const auto cz = z - m_lo[2];
+        if (cx >= m_cdim[0] || cy >= m_cdim[1] || cz >= m_cdim[2])
+            return size();
+        return cx + m_cdim[0] * (cy + m_cdim[1] * cz);
+    }
+
+private:
+    std::array<std::size_t, 3> m_dim;
+    std::array<std::size_t, 3> m_cdim;
+    std::array<std::size_t, 3> m_lo = { 0, 0, 0 };
+};
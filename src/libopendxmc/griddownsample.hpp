@@ -0,0 +1,128 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+// Downsampled grid for preview simulations, blocks of factor^3 voxels are merged into one voxel.
+// Density is averaged and the most frequent material is selected for each block.
+class GridDownsample {
+public:
+    GridDownsample(const std::array<std::size_t, 3>& dim, std::size_t factor)
+        : m_dim(dim)
+        , m_factor(std::max(factor, std::size_t { 1 }))
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+            m_ddim[i] = (m_dim[i] + m_factor - 1) / m_factor;
+    }
+    const std::array<std::size_t, 3>& dimensions() const { return m_ddim; }
+    std::size_t size() const { return m_ddim[0] * m_ddim[1] * m_ddim[2]; }
+    std::size_t factor() const { return m_factor; }
+
+    std::array<double, 3> spacing(const std::array<double, 3>& spacing) const
+    {
+        return { spacing[0] * m_factor, spacing[1] * m_factor, spacing[2] * m_factor };
+    }
+
+    // Translation of downsampled grid center relative to full grid center, non zero when
+    // dimensions are not divisible by factor
+    std::array<double, 3> offset(const std::array<double, 3>& spacing) const
+    {
+        std::array<double, 3> res;
+        for (std::size_t i = 0; i < 3; ++i)
+            res[i] = (static_cast<double>(m_ddim[i] * m_factor) - static_cast<double>(m_dim[i])) * spacing[i] / 2;
+        return res;
+    }
+
+    std::vector<double> downsampleDensity(const std::vector<double>& full) const
+    {
+        std::vector<double> res(size(), 0);
+        forEachBlock([&](const std::size_t bIdx, const auto& voxels) {
+            double sum = 0;
+            for (const auto idx : voxels)
+                sum += full[idx];
+            res[bIdx] = voxels.empty() ? 0 : sum / voxels.size();
+        });
+        return res;
+    }
+
+    std::vector<std::uint8_t> downsampleMaterial(const std::vector<std::uint8_t>& full) const
+    {
+        std::vector<std::uint8_t> res(size(), 0);
+        forEachBlock([&](const std::size_t bIdx, const auto& voxels) {
+            std::vector<std::uint8_t> values(voxels.size());
+            std::transform(voxels.cbegin(), voxels.cend(), values.begin(), [&](const auto idx) { return full[idx]; });
+            std::sort(values.begin(), values.end());
+            std::uint8_t best = 0;
+            std::size_t best_count = 0;
+            for (auto it = values.cbegin(); it != values.cend();) {
+                const auto next = std::upper_bound(it, values.cend(), *it);
+                const auto count = static_cast<std::size_t>(std::distance(it, next));
+                if (count > best_count) {
+                    best_count = count;
+                    best = *it;
+                }
+                it = next;
+            }
+            res[bIdx] = best;
+        });
+        return res;
+    }
+
+    // Index in downsampled grid of a voxel in the full grid
+    std::size_t gridIndex(std::size_t fullIdx) const
+    {
+        const auto x = fullIdx % m_dim[0];
+        const auto y = (fullIdx / m_dim[0]) % m_dim[1];
+        const auto z = fullIdx / (m_dim[0] * m_dim[1]);
+        return x / m_factor + m_ddim[0] * (y / m_factor + m_ddim[1] * (z / m_factor));
+    }
+
+protected:
+    template <typename F>
+    void forEachBlock(F func) const
+    {
+        std::vector<std::size_t> zslices(m_ddim[2]);
+        std::iota(zslices.begin(), zslices.end(), 0);
+        std::for_each(std::execution::par, zslices.cbegin(), zslices.cend(), [&](const std::size_t bz) {
+            std::vector<std::size_t> voxels;
+            voxels.reserve(m_factor * m_factor * m_factor);
+            for (std::size_t by = 0; by < m_ddim[1]; ++by)
+                for (std::size_t bx = 0; bx < m_ddim[0]; ++bx) {
+                    voxels.clear();
+                    for (std::size_t z = bz * m_factor; z < std::min((bz + 1) * m_factor, m_dim[2]); ++z)
+                        for (std::size_t y = by * m_factor; y < std::min((by + 1) * m_factor, m_dim[1]); ++y)
+                            for (std::size_t x = bx * m_factor; x < std::min((bx + 1) * m_factor, m_dim[0]); ++x)
+                                voxels.push_back(x + m_dim[0] * (y + m_dim[1] * z));
+                    func(bx + m_ddim[0] * (by + m_ddim[1] * bz), voxels);
+                }
+        });
+    }
+
+private:
+    std::array<std::size_t, 3> m_dim;
+    std::array<std::size_t, 3> m_ddim;
+    std::size_t m_factor = 1;
+};
@@ -18,6 +18,15 @@ Copyright 2023 Erlend Andersen
 
 #include <h5io.hpp>
 #include <hdf5wrapper.hpp>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+
 H5IO::H5IO(QObject* parent)
     : BasePipeline(parent)
 {
@@ -42,6 +51,43 @@ void H5IO::removeBeamActor(std::shared_ptr<BeamActorContainer> beam)
         m_beams.erase(pos);
 }
 
+bool writeStatisticsJson(const QString& path, const DataContainer::SimulationStatistics& statistics)
+{
+    QJsonObject obj;
+    obj["version"] = QString::fromStdString(statistics.version);
+    obj["host"] = QString::fromStdString(statistics.host);
+    obj["cpuArchitecture"] = QString::fromStdString(statistics.cpuArchitecture);
+    obj["operatingSystem"] = QString::fromStdString(statistics.operatingSystem);
+    obj["trackingMethod"] = QString::fromStdString(statistics.trackingMethod);
+    obj["logicalCpus"] = statistics.logicalCpus;
+    obj["threads"] = statistics.threads;
+    obj["correctionLevel"] = statistics.correctionLevel;
+    obj["worldBuildTime"] = statistics.worldBuildTime;
+    obj["pilotTime"] = statistics.pilotTime;
+    obj["transportTime"] = statistics.transportTime;
+    obj["doseCollectionTime"] = statistics.doseCollectionTime;
+    obj["wallTime"] = statistics.wallTime;
+    obj["histories"] = static_cast<qint64>(statistics.histories);
+    obj["historiesPerSecond"] = statistics.historiesPerSecond();
+    obj["varianceReduction"] = statistics.varianceReduction;
+    obj["figureOfMerit"] = statistics.figureOfMerit;
+    QJsonArray beams;
+    for (const auto& b : statistics.beams) {
+        QJsonObject beam;
+        beam["name"] = QString::fromStdString(b.name);
+        beam["transportTime"] = b.transportTime;
+        beam["histories"] = static_cast<qint64>(b.histories);
+        beam["historiesPerSecond"] = b.historiesPerSecond();
+        beams.append(beam);
+    }
+    obj["beams"] = beams;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(QJsonDocument(obj).toJson()) > 0;
+}
+
 void H5IO::saveData(QString path)
 {
     emit dataProcessingStarted(ProgressWorkType::SavingFile);
@@ -51,6 +97,14 @@ void H5IO::saveData(QString path)
     bool beam_success = true;
     for (auto beam : m_beams)
         beam_success = beam_success && s.save(beam);
+
+    // optional sidecar with simulation statistics, i.e savefile.h5 -> savefile_statistics.json
+    QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+    if (settings.value("saveload/statisticsjson", false).toBool() && m_data && m_data->hasSimulationStatistics()) {
+        QFileInfo info(path);
+        const auto json_path = info.dir().absoluteFilePath(info.completeBaseName() + "_statistics.json");
+        writeStatisticsJson(json_path, m_data->getSimulationStatistics());
+    }
     emit dataProcessingFinished(ProgressWorkType::SavingFile);
 }
 
@@ -360,6 +360,37 @@ std::optional<std::array<T, N>> loadAttribute(std::unique_ptr<H5::Group>& group,
     return std::nullopt;
 }
 
+// Organ doses are stored as names and a 6 x N array of voxels, volume, mass, dose, variance and events
+std::vector<double> organDoseValues(const std::vector<DataContainer::OrganDose>& organs)
+{
+    std::vector<double> values;
+    values.reserve(organs.size() * 6);
+    for (const auto& o : organs) {
+        values.push_back(static_cast<double>(o.voxels));
+        values.push_back(o.volume);
+        values.push_back(o.mass);
+        values.push_back(o.dose);
+        values.push_back(o.variance);
+        values.push_back(o.events);
+    }
+    return values;
+}
+
+std::vector<DataContainer::OrganDose> organDoses(std::span<const std::string> names, std::span<const double> values)
+{
+    std::vector<DataContainer::OrganDose> organs(names.size());
+    for (std::size_t i = 0; i < organs.size(); ++i) {
+        organs[i].name = names[i];
+        organs[i].voxels = static_cast<std::uint64_t>(values[i * 6]);
+        organs[i].volume = values[i * 6 + 1];
+        organs[i].mass = values[i * 6 + 2];
+        organs[i].dose = values[i * 6 + 3];
+        organs[i].variance = values[i * 6 + 4];
+        organs[i].events = values[i * 6 + 5];
+    }
+    return organs;
+}
+
 HDF5Wrapper::HDF5Wrapper(const std::string& path, FileOpenMode mode)
     : m_currentMode(mode)
 {
@@ -433,17 +464,94 @@ bool HDF5Wrapper::save(std::shared_ptr<DataContainer> data)
         });
         success = success && saveArray(m_file, names, mat_names);
     }
+    // dose images are stored on the dose grid, i.e in blocks if dose was scored in blocks
+    const auto doseDim = data->doseDimensions();
     if (const auto& v = data->getDoseArray(); v.size() > 0) {
+        names[0] = "dosescoringblock";
+        const std::vector<std::uint64_t> block = { data->doseScoringBlock() };
+        success = success && saveArray(m_file, names, std::span { block });
         names[0] = "dosearray";
-        success = success && saveArray(m_file, names, std::span { v }, dim, true);
+        success = success && saveArray(m_file, names, std::span { v }, doseDim, true);
+        names[0] = "doseunits";
+        success = success && saveArray(m_file, names, std::vector<std::string> { data->doseUnits() });
+        names[0] = "doseairmasked";
+        const std::vector<std::uint8_t> airMasked = { data->isAirMasked() ? std::uint8_t { 1 } : std::uint8_t { 0 } };
+        success = success && saveArray(m_file, names, std::span { airMasked });
     }
     if (const auto& v = data->getDoseVarianceArray(); v.size() > 0) {
         names[0] = "dosevariancearray";
-        success = success && saveArray(m_file, names, std::span { v }, dim, true);
+        success = success && saveArray(m_file, names, std::span { v }, doseDim, true);
     }
     if (const auto& v = data->getDoseEventCountArray(); v.size() > 0) {
         names[0] = "doseeventcountarray";
-        success = success && saveArray(m_file, names, std::span { v }, dim, true);
+        success = success && saveArray(m_file, names, std::span { v }, doseDim, true);
+    }
+    if (const auto& v = data->getOrganDoses(); v.size() > 0) {
+        names[0] = "organdosenames";
+        std::vector<std::string> organ_names(v.size());
+        std::transform(v.cbegin(), v.cend(), organ_names.begin(), [](const auto& o) { return o.name; });
+        success = success && saveArray(m_file, names, organ_names);
+        names[0] = "organdosevalues";
+        const auto values = organDoseValues(v);
+        success = success && saveArray<double, 2>(m_file, names, std::span { values }, { 6, v.size() });
+    }
+    if (const auto& v = data->getSweepResults(); v.size() > 0) {
+        // organ doses of all results are concatenated, with number of organs for each result
+        names[0] = "sweepresultnames";
+        std::vector<std::string> result_names(v.size());
+        std::transform(v.cbegin(), v.cend(), result_names.begin(), [](const auto& r) { return r.name; });
+        success = success && saveArray(m_file, names, result_names);
+        names[0] = "sweepresultorgans";
+        std::vector<std::uint64_t> counts(v.size());
+        std::transform(v.cbegin(), v.cend(), counts.begin(), [](const auto& r) { return static_cast<std::uint64_t>(r.doses.size()); });
+        success = success && saveArray(m_file, names, std::span<const std::uint64_t> { counts });
+        std::vector<DataContainer::OrganDose> organs;
+        for (const auto& r : v)
+            organs.insert(organs.end(), r.doses.cbegin(), r.doses.cend());
+        if (organs.size() > 0) {
+            names[0] = "sweeporgandosenames";
+            std::vector<std::string> organ_names(organs.size());
+            std::transform(organs.cbegin(), organs.cend(), organ_names.begin(), [](const auto& o) { return o.name; });
+            success = success && saveArray(m_file, names, organ_names);
+            names[0] = "sweeporgandosevalues";
+            const auto values = organDoseValues(organs);
+            success = success && saveArray<double, 2>(m_file, names, std::span { values }, { 6, organs.size() });
+        }
+    }
+    if (data->hasSimulationStatistics()) {
+        const auto& v = data->getSimulationStatistics();
+        names[0] = "simulationstatisticsinfo";
+        std::vector<std::string> info = { v.version, v.host, v.cpuArchitecture, v.operatingSystem, v.trackingMethod };
+        success = success && saveArray(m_file, names, info);
+        names[0] = "simulationstatisticsvalues";
+        std::vector<double> values = {
+            static_cast<double>(v.logicalCpus),
+            static_cast<double>(v.threads),
+            static_cast<double>(v.correctionLevel),
+            v.worldBuildTime,
+            v.pilotTime,
+            v.transportTime,
+            v.doseCollectionTime,
+            v.wallTime,
+            static_cast<double>(v.histories),
+            v.varianceReduction ? 1.0 : 0.0,
+            v.figureOfMerit
+        };
+        success = success && saveArray<double>(m_file, names, values);
+        if (v.beams.size() > 0) {
+            names[0] = "simulationbeamnames";
+            std::vector<std::string> beam_names(v.beams.size());
+            std::transform(v.beams.cbegin(), v.beams.cend(), beam_names.begin(), [](const auto& b) { return b.name; });
+            success = success && saveArray(m_file, names, beam_names);
+            names[0] = "simulationbeamvalues";
+            std::vector<double> beam_values;
+            beam_values.reserve(v.beams.size() * 2);
+            for (const auto& b : v.beams) {
+                beam_values.push_back(b.transportTime);
+                beam_values.push_back(static_cast<double>(b.histories));
+            }
+            success = success && saveArray<double, 2>(m_file, names, std::span { beam_values }, { 2, v.beams.size() });
+        }
     }
     if (const auto& v = data->aecData(); v.size() > 2) {
         names[0] = "aecweights";
@@ -1125,18 +1233,85 @@ std::shared_ptr<DataContainer> HDF5Wrapper::load()
         v = loadArray<double>(m_file, "ctarray");
         if (v.size() == res->size())
             res->setImageArray(DataContainer::ImageType::CT, v);
+        // files without a block size are scored per voxel
+        if (auto block = loadArray<std::uint64_t>(m_file, "dosescoringblock"); block.size() == 1)
+            res->setDoseScoringBlock(block[0]);
         v = loadArray<double>(m_file, "dosearray");
-        if (v.size() == res->size())
+        if (v.size() == res->doseSize())
             res->setImageArray(DataContainer::ImageType::Dose, v);
+        // dose is stored in mGy, units are for display only
+        if (auto units = loadArray<std::string>(m_file, "doseunits"); units.size() == 1)
+            res->setDoseUnits(units[0]);
+        // dose to air is stored and masked when viewed
+        if (auto airMasked = loadArray<std::uint8_t>(m_file, "doseairmasked"); airMasked.size() == 1)
+            res->setAirMasked(airMasked[0] != 0);
         v = loadArray<double>(m_file, "dosevariancearray");
-        if (v.size() == res->size())
+        if (v.size() == res->doseSize())
             res->setImageArray(DataContainer::ImageType::DoseVariance, v);
     }
     {
         auto v = loadArray<double>(m_file, "doseeventcountarray");
-        if (v.size() == res->size())
+        if (v.size() == res->doseSize())
             res->setImageArray(DataContainer::ImageType::DoseCount, v);
     }
+    {
+        auto organ_names = loadArray<std::string>(m_file, "organdosenames");
+        auto values = loadArray<double>(m_file, "organdosevalues");
+        if (organ_names.size() > 0 && values.size() == organ_names.size() * 6)
+            res->setOrganDoses(organDoses(organ_names, values));
+    }
+    {
+        auto result_names = loadArray<std::string>(m_file, "sweepresultnames");
+        auto counts = loadArray<std::uint64_t>(m_file, "sweepresultorgans");
+        auto organ_names = loadArray<std::string>(m_file, "sweeporgandosenames");
+        auto values = loadArray<double>(m_file, "sweeporgandosevalues");
+        const auto total = std::reduce(counts.cbegin(), counts.cend(), std::uint64_t { 0 });
+        if (result_names.size() > 0 && counts.size() == result_names.size() && organ_names.size() == total && values.size() == total * 6) {
+            const auto organs = organDoses(organ_names, values);
+            std::vector<DataContainer::SweepResult> results(result_names.size());
+            std::size_t offset = 0;
+            for (std::size_t i = 0; i < results.size(); ++i) {
+                results[i].name = result_names[i];
+                results[i].doses.assign(organs.cbegin() + offset, organs.cbegin() + offset + counts[i]);
+                offset += counts[i];
+            }
+            res->setSweepResults(results);
+        }
+    }
+    {
+        auto info = loadArray<std::string>(m_file, "simulationstatisticsinfo");
+        auto values = loadArray<double>(m_file, "simulationstatisticsvalues");
+        if (info.size() == 5 && values.size() == 11) {
+            DataContainer::SimulationStatistics statistics;
+            statistics.version = info[0];
+            statistics.host = info[1];
+            statistics.cpuArchitecture = info[2];
+            statistics.operatingSystem = info[3];
+            statistics.trackingMethod = info[4];
+            statistics.logicalCpus = static_cast<int>(values[0]);
+            statistics.threads = static_cast<int>(values[1]);
+            statistics.correctionLevel = static_cast<int>(values[2]);
+            statistics.worldBuildTime = values[3];
+            statistics.pilotTime = values[4];
+            statistics.transportTime = values[5];
+            statistics.doseCollectionTime = values[6];
+            statistics.wallTime = values[7];
+            statistics.histories = static_cast<std::uint64_t>(values[8]);
+            statistics.varianceReduction = values[9] > 0;
+            statistics.figureOfMerit = values[10];
+            auto beam_names = loadArray<std::string>(m_file, "simulationbeamnames");
+            auto beam_values = loadArray<double>(m_file, "simulationbeamvalues");
+            if (beam_values.size() == beam_names.size() * 2) {
+                statistics.beams.resize(beam_names.size());
+                for (std::size_t i = 0; i < beam_names.size(); ++i) {
+                    statistics.beams[i].name = beam_names[i];
+                    statistics.beams[i].transportTime = beam_values[i * 2];
+                    statistics.beams[i].histories = static_cast<std::uint64_t>(beam_values[i * 2 + 1]);
+                }
+            }
+            res->setSimulationStatistics(statistics);
+        }
+    }
     {
         auto start = loadArray<double>(m_file, "aecstart");
         auto stop = loadArray<double>(m_file, "aecstop");
@@ -259,19 +259,37 @@ void ICRPPhantomImportPipeline::importPhantom(QString organArrayPath, QString or
 {
     emit dataProcessingStarted(ProgressWorkType::Importing);
 
+    ICRPPhantom phantom {
+        .organArrayPath = organArrayPath,
+        .organMediaPath = organMediaPath,
+        .mediaPath = mediaPath,
+        .spacing_mm = { sx, sy, sz },
+        .dimensions = { static_cast<std::size_t>(x), static_cast<std::size_t>(y), static_cast<std::size_t>(z) }
+    };
+    QString error;
+    auto container = readPhantom(phantom, m_remove_arms, &error);
+    if (!error.isEmpty())
+        emit errorMessage(error);
+    if (!container)
+        return;
+
+    emit imageDataChanged(container);
+    emit dataProcessingFinished(ProgressWorkType::Importing);
+}
+
+std::shared_ptr<DataContainer> ICRPPhantomImportPipeline::readPhantom(const ICRPPhantom& phantom, bool removeArms, QString* errorMessage)
+{
     auto container = std::make_shared<DataContainer>();
-    const std::array spacing_mm = { sx, sy, sz };
-    const std::array dimensions = { static_cast<std::size_t>(x), static_cast<std::size_t>(y), static_cast<std::size_t>(z) };
-    container->setDimensions(dimensions);
-    container->setSpacingInmm(spacing_mm);
+    container->setDimensions(phantom.dimensions);
+    container->setSpacingInmm(phantom.spacing_mm);
 
-    auto organArray = readOrganArray(organArrayPath.toStdString(), container->dimensions());
+    auto organArray = readOrganArray(phantom.organArrayPath.toStdString(), container->dimensions());
 
-    auto organs = readOrgans(organMediaPath.toStdString());
+    auto organs = readOrgans(phantom.organMediaPath.toStdString());
     if (organs.size() == 0)
-        return;
+        return nullptr;
     organs.push_back({ .density = 0.001, .ID = 0, .materialID = 0, .name = "Air" });
-    if (m_remove_arms) {
+    if (removeArms) {
         for (auto& organ : organs) {
             // find arm string
             auto armPos = organ.name.find("arm");
@@ -294,9 +312,9 @@ void ICRPPhantomImportPipeline::importPhantom(QString organArrayPath, QString or
     }
     pruneOrganArray(organArray, organs);
 
-    auto media = readMedia(mediaPath.toStdString());
+    auto media = readMedia(phantom.mediaPath.toStdString());
     if (media.size() == 0)
-        return;
+        return nullptr;
     media.push_back({ .ID = 0, .composition = { { 7, 0.8 }, { 8, 0.20 } }, .name = "Air" });
     pruneMedia(organs, media);
 
@@ -309,8 +327,8 @@ void ICRPPhantomImportPipeline::importPhantom(QString organArrayPath, QString or
         container->setOrganNames(organNames);
     }
 
-    if (!success) {
-        emit errorMessage(tr("Could not read organ array"));
+    if (!success && errorMessage) {
+        *errorMessage = tr("Could not read organ array");
     }
 
     std::vector<std::uint8_t> mediaArray(organArray.size());
@@ -346,6 +364,5 @@ void ICRPPhantomImportPipeline::importPhantom(QString organArrayPath, QString or
         }
         container->setMaterials(mats);
     }
-    emit imageDataChanged(container);
-    emit dataProcessingFinished(ProgressWorkType::Importing);
+    return container;
 }
@@ -22,6 +22,20 @@ Copyright 2023 Erlend Andersen
 #include <datacontainer.hpp>
 
 #include <QObject>
+#include <QString>
+
+#include <array>
+#include <vector>
+
+// File locations and geometry of an ICRP phantom
+struct ICRPPhantom {
+    QString name;
+    QString organArrayPath;
+    QString organMediaPath;
+    QString mediaPath;
+    std::array<double, 3> spacing_mm = { 1, 1, 1 };
+    std::array<std::size_t, 3> dimensions = { 1, 1, 1 };
+};
 
 class ICRPPhantomImportPipeline : public BasePipeline {
     Q_OBJECT;
@@ -32,10 +46,15 @@ public:
     void updateImageData(std::shared_ptr<DataContainer>) override;
     void setRemoveArms(bool on);
     void importPhantom(QString organArrayPath, QString organMediaPath, QString mediaPath, double, double, double, int, int, int);
+    // Reads phantom files, returns nullptr if organ or media definitions could not be read
+    static std::shared_ptr<DataContainer> readPhantom(const ICRPPhantom& phantom, bool removeArms, QString* errorMessage = nullptr);
 
 signals:
     void errorMessage(QString);
 
 private:
     bool m_remove_arms = false;
-};
\ No newline at end of file
+};
+
+// Allow std::vector<ICRPPhantom> to be used in signal/slots
+Q_DECLARE_METATYPE(std::vector<ICRPPhantom>)
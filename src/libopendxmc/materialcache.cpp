@@ -0,0 +1,95 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <materialcache.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+MaterialCache& MaterialCache::instance()
+{
+    static MaterialCache cache;
+    return cache;
+}
+
+MaterialCache::Key MaterialCache::key(const std::map<std::uint64_t, double>& Z)
+{
+    // Weight fractions are rounded to 1e-9, well below the precision of tabulated compositions
+    constexpr double resolution = 1e9;
+    const auto sum = std::transform_reduce(Z.cbegin(), Z.cend(), 0.0, std::plus {}, [](const auto& p) { return std::max(p.second, 0.0); });
+    Key k;
+    if (sum <= 0)
+        return k;
+    for (const auto& [z, w] : Z) {
+        const auto f = static_cast<std::uint64_t>(std::round(std::max(w, 0.0) / sum * resolution));
+        if (f > 0)
+            k[z] = f;
+    }
+    return k;
+}
+
+std::optional<Material> MaterialCache::byWeight(const std::map<std::uint64_t, double>& Z)
+{
+    auto& cache = instance();
+    const auto k = key(Z);
+    {
+        std::lock_guard lock(cache.m_mutex);
+        if (auto it = cache.m_compositions.find(k); it != cache.m_compositions.end())
+            return it->second;
+    }
+    // Built without holding the lock, concurrent requests of the same composition may build it twice
+    auto material = Material::byWeight(Z);
+    if (material) {
+        std::lock_guard lock(cache.m_mutex);
+        cache.m_compositions.try_emplace(k, material.value());
+    }
+    return material;
+}
+
+std::optional<Material> MaterialCache::byNistName(const std::string& name)
+{
+    auto& cache = instance();
+    {
+        std::lock_guard lock(cache.m_mutex);
+        if (auto it = cache.m_nist.find(name); it != cache.m_nist.end())
+            return it->second;
+    }
+    auto material = Material::byNistName(name);
+    if (material) {
+        std::lock_guard lock(cache.m_mutex);
+        cache.m_nist.try_emplace(name, material.value());
+    }
+    return material;
+}
+
+std::size_t MaterialCache::size()
+{
+    auto& cache = instance();
+    std::lock_guard lock(cache.m_mutex);
+    return cache.m_compositions.size() + cache.m_nist.size();
+}
+
+void MaterialCache::clear()
+{
+    auto& cache = instance();
+    std::lock_guard lock(cache.m_mutex);
+    cache.m_compositions.clear();
+    cache.m_nist.clear();
+}
@@ -0,0 +1,50 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <dxmc_specialization.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// Process wide cache of materials. Building a material computes its attenuation and form factor
+// tables, with the cache each composition is built once and copied on later requests. Compositions
+// are keyed by normalized weight fractions so equal compositions with different scaling share entry.
+// All functions are thread safe.
+class MaterialCache {
+public:
+    static std::optional<Material> byWeight(const std::map<std::uint64_t, double>& Z);
+    static std::optional<Material> byNistName(const std::string& name);
+    static std::size_t size();
+    static void clear();
+
+protected:
+    using Key = std::map<std::uint64_t, std::uint64_t>;
+    static Key key(const std::map<std::uint64_t, double>& Z);
+    static MaterialCache& instance();
+
+private:
+    MaterialCache() = default;
+    std::mutex m_mutex;
+    std::map<Key, Material> m_compositions;
+    std::map<std::string, Material> m_nist;
+};
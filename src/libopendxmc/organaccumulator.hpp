@@ -0,0 +1,87 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// Sums over the voxels of one organ
+struct OrganAccumulator {
+    std::uint64_t voxels = 0;
+    double mass = 0;
+    double energy = 0; // energy imparted, dose times mass
+    double variance = 0; // variance of energy imparted, voxel doses are assumed independent
+    double events = 0;
+};
+
+// Dose of a single voxel as returned by the voxelDose callback of accumulateOrgans
+struct VoxelDose {
+    double dose = 0;
+    double variance = 0;
+    double events = 0;
+};
+
+// Voxel count, mass, energy imparted, its variance and number of events for each organ in one
+// parallel pass. The volume is split in chunks with a histogram for each chunk, these are summed
+// afterwards. voxelDose(i) returns the VoxelDose of voxel i. Voxels in the air mask count towards
+// voxels and mass but have no dose, the mask is ignored unless it has the size of the organ array.
+template <typename VoxelDoseFunc>
+std::array<OrganAccumulator, 256> accumulateOrgans(const std::vector<std::uint8_t>& organArray, const std::vector<double>& densityArray, double voxelVolume, const std::vector<std::uint8_t>& airMask, VoxelDoseFunc voxelDose)
+{
+    using Histogram = std::array<OrganAccumulator, 256>;
+    const bool masked = airMask.size() == organArray.size();
+    const auto N = std::min(organArray.size(), densityArray.size());
+    const auto nchunks = std::clamp(static_cast<std::size_t>(std::thread::hardware_concurrency()) * 4, std::size_t { 1 }, std::max(N, std::size_t { 1 }));
+    std::vector<Histogram> histograms(nchunks);
+    std::vector<std::size_t> chunks(nchunks);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    std::for_each(std::execution::par, chunks.cbegin(), chunks.cend(), [&](const std::size_t c) {
+        auto& histogram = histograms[c];
+        const auto start = (N * c) / nchunks;
+        const auto stop = (N * (c + 1)) / nchunks;
+        for (std::size_t i = start; i < stop; ++i) {
+            const auto mass = densityArray[i] * voxelVolume;
+            auto& acc = histogram[organArray[i]];
+            acc.voxels++;
+            acc.mass += mass;
+            if (masked && airMask[i])
+                continue;
+            const VoxelDose d = voxelDose(i);
+            acc.energy += d.dose * mass;
+            acc.variance += d.variance * mass * mass;
+            acc.events += d.events;
+        }
+    });
+
+    Histogram total;
+    for (const auto& histogram : histograms)
+        for (std::size_t o = 0; o < total.size(); ++o) {
+            total[o].voxels += histogram[o].voxels;
+            total[o].mass += histogram[o].mass;
+            total[o].energy += histogram[o].energy;
+            total[o].variance += histogram[o].variance;
+            total[o].events += histogram[o].events;
+        }
+    return total;
+}
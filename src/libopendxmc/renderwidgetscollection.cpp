@@ -66,13 +66,15 @@ public:
                 auto ww = property->GetColorWindow();
                 auto wl = property->GetColorLevel();
                 if (windowLevelText) {
+                    // window is shown in display units
+                    const auto scale = widgets[0] ? widgets[0]->displayScale() : 1.0;
                     std::array<char, 10> buffer;
                     std::string txt = "WL: ";
-                    if (auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), wl, std::chars_format::general, 3); ec == std::errc()) {
+                    if (auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), wl * scale, std::chars_format::general, 3); ec == std::errc()) {
                         txt += std::string_view(buffer.data(), ptr);
                     }
                     txt += " WW: ";
-                    if (auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), ww, std::chars_format::general, 3); ec == std::errc()) {
+                    if (auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), ww * scale, std::chars_format::general, 3); ec == std::errc()) {
                         txt += std::string_view(buffer.data(), ptr);
                     }
                     windowLevelText->SetInput(txt.c_str());
@@ -0,0 +1,68 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <roidosepipeline.hpp>
+
+ROIDosePipeline::ROIDosePipeline(QObject* parent)
+    : BasePipeline(parent)
+{
+}
+
+void ROIDosePipeline::updateImageData(std::shared_ptr<DataContainer> data)
+{
+    m_data = data;
+    QStringList organs;
+    if (m_data && m_data->hasImage(DataContainer::ImageType::Organ))
+        for (const auto& n : m_data->getOrganNames())
+            organs.append(QString::fromStdString(n));
+    emit organNamesChanged(organs);
+}
+
+bool ROIDosePipeline::updateQuery()
+{
+    if (!m_data || !m_data->hasImage(DataContainer::ImageType::Dose)) {
+        m_query = nullptr;
+        return false;
+    }
+    if (!m_query || m_query->dataID() != m_data->ID()) {
+        emit dataProcessingStarted(ProgressWorkType::Arbitrary);
+        m_query = ROIDoseQuery::create(m_data);
+        emit dataProcessingFinished(ProgressWorkType::Arbitrary);
+    }
+    return m_query != nullptr;
+}
+
+void ROIDosePipeline::computeBox(double x, double y, double z, double sizeX, double sizeY, double sizeZ, int organ)
+{
+    if (!updateQuery())
+        return;
+    const std::array<double, 6> corners = { x - sizeX / 2, y - sizeY / 2, z - sizeZ / 2, x + sizeX / 2, y + sizeY / 2, z + sizeZ / 2 };
+    const auto res = organ < 0 ? m_query->box(corners) : m_query->box(corners, static_cast<std::uint8_t>(organ));
+    emit roiDoseComputed(res.dose * m_data->displayScale(DataContainer::ImageType::Dose), res.mass, res.voxels, QString::fromStdString(m_data->units(DataContainer::ImageType::Dose)));
+}
+
+void ROIDosePipeline::computeSphere(double x, double y, double z, double radius, int organ)
+{
+    if (!updateQuery())
+        return;
+    std::optional<std::uint8_t> organIdx;
+    if (organ >= 0)
+        organIdx = static_cast<std::uint8_t>(organ);
+    const auto res = m_query->sphere({ x, y, z }, radius, organIdx);
+    emit roiDoseComputed(res.dose * m_data->displayScale(DataContainer::ImageType::Dose), res.mass, res.voxels, QString::fromStdString(m_data->units(DataContainer::ImageType::Dose)));
+}
@@ -0,0 +1,50 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <basepipeline.hpp>
+#include <datacontainer.hpp>
+#include <roidosequery.hpp>
+
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class ROIDosePipeline : public BasePipeline {
+    Q_OBJECT
+public:
+    ROIDosePipeline(QObject* parent = nullptr);
+    void updateImageData(std::shared_ptr<DataContainer>) override;
+    // Positions and sizes in cm relative to image center, organ < 0 for all voxels
+    void computeBox(double x, double y, double z, double sizeX, double sizeY, double sizeZ, int organ);
+    void computeSphere(double x, double y, double z, double radius, int organ);
+
+signals:
+    void organNamesChanged(QStringList organs);
+    void roiDoseComputed(double dose, double mass, qulonglong voxels, QString units);
+
+protected:
+    // Summed volume tables are built on first query after dose is changed
+    bool updateQuery();
+
+private:
+    std::shared_ptr<DataContainer> m_data = nullptr;
+    std::shared_ptr<ROIDoseQuery> m_query = nullptr;
+};
@@ -0,0 +1,195 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <roidosequery.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+// In place prefix sum along one axis of a table with dimensions dim (including the zero border)
+void prefixSum(std::vector<double>& table, const std::array<std::size_t, 3>& dim, std::size_t axis)
+{
+    const std::array<std::size_t, 3> stride = { 1, dim[0], dim[0] * dim[1] };
+    // lines are enumerated by the two other axes
+    const auto a = (axis + 1) % 3;
+    const auto b = (axis + 2) % 3;
+    std::vector<std::size_t> lines(dim[a] * dim[b]);
+    std::iota(lines.begin(), lines.end(), 0);
+    std::for_each(std::execution::par_unseq, lines.cbegin(), lines.cend(), [&](const auto l) {
+        const auto start = (l % dim[a]) * stride[a] + (l / dim[a]) * stride[b];
+        for (std::size_t i = 1; i < dim[axis]; ++i)
+            table[start + i * stride[axis]] += table[start + (i - 1) * stride[axis]];
+    });
+}
+
+std::shared_ptr<ROIDoseQuery> ROIDoseQuery::create(std::shared_ptr<DataContainer> data)
+{
+    if (!data || !data->hasImage(DataContainer::ImageType::Dose) || !data->hasImage(DataContainer::ImageType::Density))
+        return nullptr;
+
+    auto query = std::shared_ptr<ROIDoseQuery>(new ROIDoseQuery);
+    query->m_dataID = data->ID();
+    query->m_data = data;
+    query->m_dim = data->dimensions();
+    query->m_spacing = data->spacing();
+    query->m_voxelVolume = std::reduce(query->m_spacing.cbegin(), query->m_spacing.cend(), 1.0, std::multiplies {});
+
+    const auto& dim = query->m_dim;
+    const std::array<std::size_t, 3> tdim = { dim[0] + 1, dim[1] + 1, dim[2] + 1 };
+    const auto tsize = tdim[0] * tdim[1] * tdim[2];
+    query->m_energyTable.assign(tsize, 0);
+    query->m_massTable.assign(tsize, 0);
+
+    const auto& dose = data->getDoseArray();
+    const auto& density = data->getDensityArray();
+    // dose is zero in air if air dose is masked
+    const bool masked = data->isAirMasked();
+    const auto& airMask = data->airMask();
+    std::vector<std::size_t> zslices(dim[2]);
+    std::iota(zslices.begin(), zslices.end(), 0);
+    std::for_each(std::execution::par_unseq, zslices.cbegin(), zslices.cend(), [&](const auto z) {
+        for (std::size_t y = 0; y < dim[1]; ++y)
+            for (std::size_t x = 0; x < dim[0]; ++x) {
+                const auto i = x + dim[0] * (y + dim[1] * z);
+                const auto t = query->tableIndex(x + 1, y + 1, z + 1);
+                const auto mass = density[i] * query->m_voxelVolume;
+                query->m_massTable[t] = mass;
+                query->m_energyTable[t] = masked && airMask[i] ? 0.0 : dose[data->doseIndex(i)] * mass;
+            }
+    });
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        prefixSum(query->m_massTable, tdim, axis);
+        prefixSum(query->m_energyTable, tdim, axis);
+    }
+    return query;
+}
+
+ROIDoseQuery::Result ROIDoseQuery::box(const std::array<std::size_t, 6>& indices) const
+{
+    Result res;
+    std::array<std::size_t, 6> r;
+    for (std::size_t i = 0; i < 3; ++i) {
+        r[i] = std::min(indices[i], m_dim[i]);
+        r[i + 3] = std::min(indices[i + 3], m_dim[i]);
+        if (r[i + 3] <= r[i])
+            return res;
+    }
+    // inclusion exclusion over the eight corners, corners with an odd number of lower bounds are subtracted
+    double energy = 0;
+    double mass = 0;
+    for (unsigned c = 0; c < 8; ++c) {
+        const auto t = tableIndex(c & 1 ? r[3] : r[0], c & 2 ? r[4] : r[1], c & 4 ? r[5] : r[2]);
+        const auto sign = (3 - std::popcount(c)) % 2 == 1 ? -1.0 : 1.0;
+        energy += sign * m_energyTable[t];
+        mass += sign * m_massTable[t];
+    }
+    res.voxels = (r[3] - r[0]) * (r[4] - r[1]) * (r[5] - r[2]);
+    res.mass = mass;
+    res.dose = mass > 0 ? energy / mass : 0;
+    return res;
+}
+
+std::array<std::size_t, 6> ROIDoseQuery::indexRange(const std::array<double, 6>& corners) const
+{
+    // indices of voxels with center inside [min, max], voxel centers are at (i + 0.5) * spacing - half
+    std::array<std::size_t, 6> r;
+    for (std::size_t i = 0; i < 3; ++i) {
+        const auto half = m_dim[i] * m_spacing[i] / 2;
+        const auto lower = std::ceil((std::min(corners[i], corners[i + 3]) + half) / m_spacing[i] - 0.5);
+        const auto upper = std::floor((std::max(corners[i], corners[i + 3]) + half) / m_spacing[i] - 0.5) + 1;
+        r[i] = static_cast<std::size_t>(std::clamp(lower, 0.0, static_cast<double>(m_dim[i])));
+        r[i + 3] = static_cast<std::size_t>(std::clamp(upper, 0.0, static_cast<double>(m_dim[i])));
+    }
+    return r;
+}
+
+ROIDoseQuery::Result ROIDoseQuery::box(const std::array<double, 6>& corners) const
+{
+    return box(indexRange(corners));
+}
+
+template <typename Inside>
+ROIDoseQuery::Result ROIDoseQuery::scan(const std::array<std::size_t, 6>& r, Inside inside) const
+{
+    struct Sum {
+        double energy = 0;
+        double mass = 0;
+        std::uint64_t voxels = 0;
+    };
+    const auto& dose = m_data->getDoseArray();
+    const auto& density = m_data->getDensityArray();
+    const bool masked = m_data->isAirMasked();
+    const auto& airMask = m_data->airMask();
+    std::vector<std::size_t> zslices(r[5] > r[2] ? r[5] - r[2] : 0);
+    std::iota(zslices.begin(), zslices.end(), r[2]);
+    std::vector<Sum> sums(zslices.size());
+    std::for_each(std::execution::par, zslices.cbegin(), zslices.cend(), [&](const auto z) {
+        auto& sum = sums[z - r[2]];
+        for (std::size_t y = r[1]; y < r[4]; ++y)
+            for (std::size_t x = r[0]; x < r[3]; ++x) {
+                const auto i = x + m_dim[0] * (y + m_dim[1] * z);
+                if (inside(x, y, z, i)) {
+                    const auto mass = density[i] * m_voxelVolume;
+                    if (!masked || !airMask[i])
+                        sum.energy += dose[m_data->doseIndex(i)] * mass;
+                    sum.mass += mass;
+                    sum.voxels++;
+                }
+            }
+    });
+    Result res;
+    double energy = 0;
+    for (const auto& s : sums) {
+        energy += s.energy;
+        res.mass += s.mass;
+        res.voxels += s.voxels;
+    }
+    res.dose = res.mass > 0 ? energy / res.mass : 0;
+    return res;
+}
+
+ROIDoseQuery::Result ROIDoseQuery::box(const std::array<double, 6>& corners, std::uint8_t organ) const
+{
+    if (!m_data->hasImage(DataContainer::ImageType::Organ))
+        return Result {};
+    const auto& organArray = m_data->getOrganArray();
+    return scan(indexRange(corners), [&](std::size_t, std::size_t, std::size_t, std::size_t i) { return organArray[i] == organ; });
+}
+
+ROIDoseQuery::Result ROIDoseQuery::sphere(const std::array<double, 3>& center, double radius, std::optional<std::uint8_t> organ) const
+{
+    if (organ && !m_data->hasImage(DataContainer::ImageType::Organ))
+        return Result {};
+    const std::array<double, 6> corners = { center[0] - radius, center[1] - radius, center[2] - radius, center[0] + radius, center[1] + radius, center[2] + radius };
+    const auto r2 = radius * radius;
+    const auto& organArray = m_data->getOrganArray();
+    return scan(indexRange(corners), [&](std::size_t x, std::size_t y, std::size_t z, std::size_t i) {
+        if (organ && organArray[i] != organ.value())
+            return false;
+        const std::array<std::size_t, 3> idx = { x, y, z };
+        double d2 = 0;
+        for (std::size_t k = 0; k < 3; ++k) {
+            const auto p = (idx[k] + 0.5) * m_spacing[k] - m_dim[k] * m_spacing[k] / 2 - center[k];
+            d2 += p * p;
+        }
+        return d2 <= r2;
+    });
+}
@@ -0,0 +1,75 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <datacontainer.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Mean dose in regions of interest. Summed volume tables of dose times mass and of mass are built
+// once, then axis aligned boxes are answered in constant time. Spheres and boxes restricted to an
+// organ are answered by scanning voxels in the bounding box only. Positions are in cm relative to
+// image center, and a voxel is inside a region if its center is.
+class ROIDoseQuery {
+public:
+    struct Result {
+        double dose = 0; // mass weighted mean dose
+        double mass = 0; // g
+        std::uint64_t voxels = 0;
+    };
+
+    // Returns nullptr if data has no dose or density image
+    static std::shared_ptr<ROIDoseQuery> create(std::shared_ptr<DataContainer> data);
+
+    // ID of the data container the tables were built from, changes when dose is replaced
+    std::uint64_t dataID() const { return m_dataID; }
+
+    // Voxel index ranges [begin, end) for x, y and z
+    Result box(const std::array<std::size_t, 6>& indices) const;
+    // Box corners (xmin, ymin, zmin, xmax, ymax, zmax) in cm
+    Result box(const std::array<double, 6>& corners) const;
+    // Box restricted to voxels of an organ
+    Result box(const std::array<double, 6>& corners, std::uint8_t organ) const;
+    // Sphere optionally restricted to voxels of an organ
+    Result sphere(const std::array<double, 3>& center, double radius, std::optional<std::uint8_t> organ = std::nullopt) const;
+
+protected:
+    ROIDoseQuery() = default;
+    std::size_t tableIndex(std::size_t x, std::size_t y, std::size_t z) const
+    {
+        return x + (m_dim[0] + 1) * (y + (m_dim[1] + 1) * z);
+    }
+    std::array<std::size_t, 6> indexRange(const std::array<double, 6>& corners) const;
+    template <typename Inside>
+    Result scan(const std::array<std::size_t, 6>& indices, Inside inside) const;
+
+private:
+    std::uint64_t m_dataID = 0;
+    std::array<std::size_t, 3> m_dim = { 0, 0, 0 };
+    std::array<double, 3> m_spacing = { 1, 1, 1 };
+    double m_voxelVolume = 1;
+    std::vector<double> m_energyTable; // dose times mass
+    std::vector<double> m_massTable;
+    // kept for scans of organ restricted and spherical regions
+    std::shared_ptr<DataContainer> m_data = nullptr;
+};
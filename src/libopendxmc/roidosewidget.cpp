@@ -0,0 +1,105 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <roidosewidget.hpp>
+
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+ROIDoseWidget::ROIDoseWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    auto layout = new QVBoxLayout;
+    setLayout(layout);
+
+    auto roi_box = new QGroupBox(tr("Region of interest"), this);
+    auto roi_layout = new QGridLayout;
+    roi_box->setLayout(roi_layout);
+
+    m_shape = new QComboBox(roi_box);
+    m_shape->addItem(tr("Box"));
+    m_shape->addItem(tr("Sphere"));
+    roi_layout->addWidget(new QLabel(tr("Shape"), roi_box), 0, 0);
+    roi_layout->addWidget(m_shape, 0, 1, 1, 3);
+
+    const QStringList axis = { "X", "Y", "Z" };
+    roi_layout->addWidget(new QLabel(tr("Center [cm]"), roi_box), 1, 0);
+    auto size_label = new QLabel(tr("Size [cm]"), roi_box);
+    roi_layout->addWidget(size_label, 2, 0);
+    for (int i = 0; i < 3; ++i) {
+        m_center[i] = new QDoubleSpinBox(roi_box);
+        m_center[i]->setRange(-500, 500);
+        m_center[i]->setSuffix(QString(" ") + axis[i]);
+        roi_layout->addWidget(m_center[i], 1, i + 1);
+        m_size[i] = new QDoubleSpinBox(roi_box);
+        m_size[i]->setRange(0, 1000);
+        m_size[i]->setValue(5);
+        m_size[i]->setSuffix(QString(" ") + axis[i]);
+        roi_layout->addWidget(m_size[i], 2, i + 1);
+    }
+    connect(m_shape, &QComboBox::currentIndexChanged, [this, size_label](int index) {
+        // sphere uses first size as radius
+        size_label->setText(index == 0 ? tr("Size [cm]") : tr("Radius [cm]"));
+        m_size[1]->setVisible(index == 0);
+        m_size[2]->setVisible(index == 0);
+    });
+
+    m_organ = new QComboBox(roi_box);
+    m_organ->addItem(tr("All voxels"));
+    roi_layout->addWidget(new QLabel(tr("Organ"), roi_box), 3, 0);
+    roi_layout->addWidget(m_organ, 3, 1, 1, 3);
+
+    auto compute_button = new QPushButton(tr("Compute mean dose"), roi_box);
+    roi_layout->addWidget(compute_button, 4, 0, 1, 4);
+    connect(compute_button, &QPushButton::clicked, [this]() {
+        // first item is all voxels
+        const int organ = m_organ->currentIndex() - 1;
+        if (m_shape->currentIndex() == 0)
+            emit requestBoxDose(m_center[0]->value(), m_center[1]->value(), m_center[2]->value(), m_size[0]->value(), m_size[1]->value(), m_size[2]->value(), organ);
+        else
+            emit requestSphereDose(m_center[0]->value(), m_center[1]->value(), m_center[2]->value(), m_size[0]->value(), organ);
+    });
+    layout->addWidget(roi_box);
+
+    m_result = new QLabel(this);
+    m_result->setWordWrap(true);
+    layout->addWidget(m_result);
+    layout->addStretch(100);
+}
+
+void ROIDoseWidget::setOrganNames(QStringList organs)
+{
+    m_organ->clear();
+    m_organ->addItem(tr("All voxels"));
+    m_organ->addItems(organs);
+    m_result->clear();
+}
+
+void ROIDoseWidget::setROIDose(double dose, double mass, qulonglong voxels, QString units)
+{
+    if (voxels == 0) {
+        m_result->setText(tr("No voxels in region"));
+        return;
+    }
+    m_result->setText(tr("Mean dose ") + QString::number(dose, 'g', 4) + " " + units + tr(", mass ") + QString::number(mass, 'g', 4) + tr(" g, ") + QString::number(voxels) + tr(" voxels"));
+}
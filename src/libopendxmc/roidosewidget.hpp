@@ -0,0 +1,48 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <QStringList>
+#include <QWidget>
+
+#include <array>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+
+// Mean dose in a box or sphere, optionally restricted to an organ
+class ROIDoseWidget : public QWidget {
+    Q_OBJECT
+public:
+    ROIDoseWidget(QWidget* parent = nullptr);
+    void setOrganNames(QStringList organs);
+    void setROIDose(double dose, double mass, qulonglong voxels, QString units);
+
+signals:
+    void requestBoxDose(double x, double y, double z, double sizeX, double sizeY, double sizeZ, int organ);
+    void requestSphereDose(double x, double y, double z, double radius, int organ);
+
+private:
+    QComboBox* m_shape = nullptr;
+    QComboBox* m_organ = nullptr;
+    std::array<QDoubleSpinBox*, 3> m_center = { nullptr, nullptr, nullptr };
+    std::array<QDoubleSpinBox*, 3> m_size = { nullptr, nullptr, nullptr };
+    QLabel* m_result = nullptr;
+};
@@ -0,0 +1,189 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dxmc_specialization.hpp>
+#include <simulationmemoryestimate.hpp>
+
+#include <dxmc/world/dosescore.hpp>
+#include <dxmc/world/energyscore.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// Materials keep attenuation coefficients of each interaction and of photoelectric effect in each
+// shell on an energy grid, and atomic form factor and scatter function on a momentum transfer grid.
+// The tables are allocated on the heap and not part of sizeof(Material).
+constexpr std::uint64_t materialShells = 5;
+constexpr std::uint64_t materialEnergyPoints = 1000;
+constexpr std::uint64_t materialMomentumTransferPoints = 500;
+constexpr std::uint64_t materialTables = ((3 + materialShells) * materialEnergyPoints + 2 * 2 * materialMomentumTransferPoints) * sizeof(double);
+
+std::uint64_t SimulationMemoryEstimate::peakMemory(const Parameters& p, std::uint64_t& worldItem, std::uint64_t& setupBuffers, std::uint64_t& outputArrays)
+{
+    // Woodcock voxel grids tallies energy and dose per block of voxels when dose is scored in blocks
+    const std::uint64_t b = p.woodcockTracking && !p.organDoseOnly && p.doseScoringBlock > 1 ? p.doseScoringBlock : 1;
+    const auto blocks = [b](std::uint64_t voxels) { return b > 1 ? voxels / (b * b * b) + 1 : voxels; };
+
+    // Voxel grids stores density and material index (padded to two doubles) per voxel, and energy and dose tallies
+    const std::uint64_t tallyElement = sizeof(dxmc::EnergyScore) + sizeof(dxmc::DoseScore) + (b > 1 ? sizeof(double) : 0);
+    worldItem = p.simulatedVoxels * 2 * sizeof(double) + blocks(p.simulatedVoxels) * tallyElement + p.materials * (sizeof(Material) + materialTables);
+    if (p.woodcockTracking) {
+        // bricks of 8^3 voxels with a short list of materials
+        worldItem += (p.simulatedVoxels / 512 + 1) * 64;
+    }
+
+    // Cropped density and material arrays are alive while the world item is set up
+    setupBuffers = p.simulatedVoxels < p.voxels ? p.simulatedVoxels * (sizeof(double) + sizeof(std::uint8_t)) : 0;
+
+    std::uint64_t outputArray = 0;
+    if (p.organDoseOnly) {
+        // chunked tallies for 256 organs
+        outputArrays = std::max(1u, std::thread::hardware_concurrency()) * 4 * 256 * 5 * sizeof(double);
+    } else {
+        // dose, variance and event count are stored per voxel or block, one temporary array while collecting
+        outputArray = blocks(p.voxels) * sizeof(double);
+        outputArrays = 4 * outputArray;
+    }
+    // Existing comparison arrays are released before results are stored and dose arrays as their
+    // replacements are stored, at least one output array comes on top of memory already in use
+    outputArrays -= std::min(p.existingDoseArrays, outputArrays - outputArray);
+    return worldItem + std::max(setupBuffers, outputArrays);
+}
+
+SimulationMemoryEstimate SimulationMemoryEstimate::estimate(const Parameters& parameters)
+{
+    SimulationMemoryEstimate res;
+    res.m_peak = peakMemory(parameters, res.m_worldItem, res.m_setupBuffers, res.m_outputArrays);
+    res.m_available = availableMemory();
+    if (res.fitsInMemory())
+        return res;
+
+    std::uint64_t w, s, o;
+    auto organOnly = parameters;
+    organOnly.organDoseOnly = true;
+    res.m_fitsWithOrganDoseOnly = peakMemory(organOnly, w, s, o) <= res.m_available;
+
+    res.m_suggestedDownsampling = 0;
+    for (std::uint64_t f = 2; f <= 4; ++f) {
+        auto down = parameters;
+        down.voxels = parameters.voxels / (f * f * f);
+        down.simulatedVoxels = parameters.simulatedVoxels / (f * f * f);
+        if (peakMemory(down, w, s, o) <= res.m_available) {
+            res.m_suggestedDownsampling = static_cast<int>(f);
+            break;
+        }
+    }
+    return res;
+}
+
+#ifdef __linux__
+std::uint64_t systemAvailableMemory()
+{
+    // MemAvailable includes reclaimable page cache
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        if (line.starts_with("MemAvailable:")) {
+            std::stringstream ss(line.substr(13));
+            std::uint64_t kb = 0;
+            if (ss >> kb)
+                return kb * 1024;
+        }
+    }
+    const auto pages = sysconf(_SC_AVPHYS_PAGES);
+    const auto pagesize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pagesize > 0)
+        return static_cast<std::uint64_t>(pages) * static_cast<std::uint64_t>(pagesize);
+    return 0;
+}
+
+// Memory left below the limit of the cgroup (v2) of the process, i.e when running in a container,
+// 0 if there is no limit. Inactive page cache is reclaimable and counts as available.
+std::uint64_t cgroupAvailableMemory()
+{
+    std::ifstream maxfile("/sys/fs/cgroup/memory.max");
+    std::uint64_t limit = 0;
+    if (!(maxfile >> limit)) // "max" if unlimited
+        return 0;
+    std::ifstream currentfile("/sys/fs/cgroup/memory.current");
+    std::uint64_t current = 0;
+    currentfile >> current;
+    std::ifstream stat("/sys/fs/cgroup/memory.stat");
+    std::string line;
+    while (std::getline(stat, line)) {
+        if (line.starts_with("inactive_file ")) {
+            std::stringstream ss(line.substr(14));
+            std::uint64_t inactive = 0;
+            if (ss >> inactive)
+                current -= std::min(current, inactive);
+        }
+    }
+    return limit > current ? limit - current : 1;
+}
+#endif
+
+std::uint64_t SimulationMemoryEstimate::availableMemory()
+{
+#ifdef __linux__
+    const auto system = systemAvailableMemory();
+    const auto cgroup = cgroupAvailableMemory();
+    if (system > 0 && cgroup > 0)
+        return std::min(system, cgroup);
+    if (system > 0 || cgroup > 0)
+        return std::max(system, cgroup);
+#endif
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+        return status.ullAvailPhys;
+#endif
+    return 0;
+}
+
+std::string toMegaBytes(std::uint64_t bytes)
+{
+    return std::to_string((bytes + (1 << 19)) >> 20) + " MB";
+}
+
+std::string SimulationMemoryEstimate::message() const
+{
+    std::string msg = "Estimated peak memory " + toMegaBytes(m_peak);
+    if (m_available > 0)
+        msg += " of " + toMegaBytes(m_available) + " available";
+    msg += " (world " + toMegaBytes(m_worldItem) + ", dose output " + toMegaBytes(m_outputArrays) + ").";
+    if (fitsInMemory())
+        return msg;
+    msg += " Simulation will not fit in memory.";
+    if (m_fitsWithOrganDoseOnly)
+        msg += " Tallying organ dose only will fit.";
+    if (m_suggestedDownsampling > 1)
+        msg += " Increasing voxel spacing by a factor " + std::to_string(m_suggestedDownsampling) + " on import will fit.";
+    return msg;
+}
@@ -0,0 +1,69 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Pre-flight estimate of peak memory use of a simulation. Sizes of the world item and
+// dose tallies are computed from the dxmc types, output arrays from the options of the
+// simulation. Memory already held by the loaded images is not included, except dose
+// arrays which are released when the results replace them.
+class SimulationMemoryEstimate {
+public:
+    struct Parameters {
+        std::uint64_t voxels = 0; // voxels in the image
+        std::uint64_t simulatedVoxels = 0; // voxels in the world item, i.e after cropping
+        std::uint64_t materials = 0;
+        bool woodcockTracking = false;
+        int doseScoringBlock = 1; // applies to Woodcock tracking only
+        bool organDoseOnly = false;
+        std::uint64_t existingDoseArrays = 0; // bytes of dose, variance, event count and comparison arrays of the image
+    };
+
+    static SimulationMemoryEstimate estimate(const Parameters& parameters);
+    // Available physical memory in bytes, limited by the memory cgroup of the process, 0 if unknown
+    static std::uint64_t availableMemory();
+
+    std::uint64_t worldItem() const { return m_worldItem; }
+    std::uint64_t setupBuffers() const { return m_setupBuffers; }
+    // Output arrays less existing dose arrays released while storing them
+    std::uint64_t outputArrays() const { return m_outputArrays; }
+    std::uint64_t peak() const { return m_peak; }
+    std::uint64_t available() const { return m_available; }
+    bool fitsInMemory() const { return m_available == 0 || m_peak <= m_available; }
+    // Smallest factor the voxel spacing must be increased by on import for the simulation to fit, 0 if not found
+    int suggestedDownsampling() const { return m_suggestedDownsampling; }
+    // Simulation fits if only organ doses are tallied
+    bool fitsWithOrganDoseOnly() const { return m_fitsWithOrganDoseOnly; }
+
+    std::string message() const;
+
+protected:
+    static std::uint64_t peakMemory(const Parameters& parameters, std::uint64_t& worldItem, std::uint64_t& setupBuffers, std::uint64_t& outputArrays);
+
+private:
+    std::uint64_t m_worldItem = 0;
+    std::uint64_t m_setupBuffers = 0;
+    std::uint64_t m_outputArrays = 0;
+    std::uint64_t m_peak = 0;
+    std::uint64_t m_available = 0;
+    int m_suggestedDownsampling = 1;
+    bool m_fitsWithOrganDoseOnly = false;
+};
@@ -18,15 +18,37 @@ Copyright 2023 Erlend Andersen
 
 #include <beamactorcontainer.hpp>
 #include <dxmc_specialization.hpp>
+#include <gridcrop.hpp>
+#include <griddownsample.hpp>
+#include <icrpphantomimportpipeline.hpp>
+#include <materialcache.hpp>
+#include <organaccumulator.hpp>
 #include <simulationpipeline.hpp>
+#include <woodcockvoxelgrid.hpp>
 
 #include <dxmc/transport.hpp>
+#include <dxmc/world/dosescore.hpp>
 #include <dxmc/world/world.hpp>
 #include <dxmc/world/worlditems/aavoxelgrid.hpp>
 
+#include <QSettings>
+#include <QStringList>
+#include <QSysInfo>
+
+#ifndef APP_VERSION
+#define APP_VERSION "unknown"
+#endif
+
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include <execution>
+#include <future>
+#include <numeric>
+#include <optional>
 #include <thread>
+#include <type_traits>
 
 SimulationPipeline::SimulationPipeline(QObject* parent)
     : BasePipeline(parent)
@@ -35,11 +57,27 @@ SimulationPipeline::SimulationPipeline(QObject* parent)
 SimulationPipeline::~SimulationPipeline()
 {
     m_progress.setStopSimulation();
+    m_pause.setPaused(false);
 }
 void SimulationPipeline::updateImageData(std::shared_ptr<DataContainer> data)
 {
+    if (!data || !m_data || data->ID() != m_data->ID()) {
+        QStringList organs;
+        if (data && data->hasImage(DataContainer::ImageType::Organ))
+            for (const auto& n : data->getOrganNames())
+                organs.append(QString::fromStdString(n));
+        emit organNamesChanged(organs);
+        m_analogFigureOfMerit = 0;
+    }
     m_data = data;
+    // dose loaded from file keeps the air masking it was saved with, the option follows it
+    if (m_data && m_data->hasImage(DataContainer::ImageType::Dose) && m_data->isAirMasked() != m_deleteAirDose) {
+        m_deleteAirDose = m_data->isAirMasked();
+        emit deleteAirDoseChanged(m_deleteAirDose);
+    }
     emit simulationReady(testIfReadyForSimulation());
+    emitCalibratedNumberOfThreads();
+    emitMemoryEstimate();
 }
 
 bool SimulationPipeline::testIfReadyForSimulation(bool test_image) const
@@ -101,9 +139,118 @@ void SimulationPipeline::setNumberOfThreads(int nthreads)
     m_threads = std::clamp(nthreads, 0, nthreads_max);
 }
 
+void SimulationPipeline::setDeleteAirDose(bool on)
+{
+    m_deleteAirDose = on;
+    emitMemoryEstimate();
+    // air dose is masked as a view on existing results, no need to simulate again
+    if (m_data && m_data->hasImage(DataContainer::ImageType::Dose)) {
+        const auto id = m_data->ID();
+        m_data->setAirMasked(on);
+        if (m_data->ID() != id)
+            emit imageDataChanged(m_data);
+    }
+}
+
+void SimulationPipeline::setCropAir(bool on)
+{
+    m_cropAir = on;
+    emitMemoryEstimate();
+}
+
+void SimulationPipeline::setOrganDoseOnly(bool on)
+{
+    m_organDoseOnly = on;
+    emitMemoryEstimate();
+}
+
+void SimulationPipeline::setAdaptiveBeamAllocation(bool on)
+{
+    m_adaptiveAllocation = on;
+}
+
+void SimulationPipeline::setVarianceReduction(bool on)
+{
+    m_varianceReduction = on;
+}
+
+void SimulationPipeline::setOrgansOfInterest(QStringList organs)
+{
+    m_organsOfInterest.clear();
+    for (const auto& o : organs)
+        m_organsOfInterest.push_back(o.toStdString());
+    m_analogFigureOfMerit = 0;
+}
+
+void SimulationPipeline::setThreadPlacement(int placement)
+{
+    m_threadPlacement = static_cast<ThreadAffinity::ThreadPlacement>(std::clamp(placement, 0, 2));
+}
+
+void SimulationPipeline::setMemoryPlacement(int placement)
+{
+    m_memoryPlacement = static_cast<ThreadAffinity::MemoryPlacement>(std::clamp(placement, 0, 2));
+}
+
+void SimulationPipeline::setWorldItemType(int type)
+{
+    m_worldItemType = static_cast<WorldItemType>(std::clamp(type, 0, 1));
+    emitCalibratedNumberOfThreads();
+    emitMemoryEstimate();
+}
+
+void SimulationPipeline::setDoseScoringBlockSize(int block)
+{
+    m_doseScoringBlock = std::clamp(block, 1, 8);
+    emitMemoryEstimate();
+}
+
+QString calibrationSettingsKey(std::shared_ptr<DataContainer> data, int correction, SimulationPipeline::WorldItemType type)
+{
+    // Grid sizes are bucketed by powers of two of the number of voxels
+    const auto bucket = static_cast<int>(std::log2(std::max(data->size(), std::size_t { 1 })));
+    auto host = QSysInfo::machineHostName();
+    host.replace('/', '_');
+    return QString("simulation/threadcalibration/") + host + QString("/n") + QString::number(bucket) + QString("c") + QString::number(correction) + QString("w") + QString::number(static_cast<int>(type));
+}
+
 void SimulationPipeline::finishingSimulation()
 {
+    if (m_calibrating) {
+        m_calibrating = false;
+        const int nthreads = m_calibratedThreads;
+        if (nthreads > 0) {
+            QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+            settings.setValue(m_calibrationKey, nthreads);
+            emitCalibratedNumberOfThreads();
+        }
+        killTimer(m_timerID);
+        emit simulationRunning(false);
+        emit dataProcessingFinished(ProgressWorkType::Simulating);
+        return;
+    }
+    if (m_batchResult) {
+        // Organ doses of each phantom are kept as sweep results of the loaded image, the image
+        // itself is kept. The last phantom is shown if no image is loaded.
+        if (m_data)
+            m_data->setSweepResults(m_batchResult->getSweepResults());
+        else
+            m_data = m_batchResult;
+        m_batchResult = nullptr;
+    }
+    if (m_data && m_data->hasSimulationStatistics()) {
+        // gain is relative to the last analog simulation of the same image and organs of interest
+        const auto& statistics = m_data->getSimulationStatistics();
+        if (statistics.figureOfMerit > 0) {
+            if (!statistics.varianceReduction)
+                m_analogFigureOfMerit = statistics.figureOfMerit;
+            const auto gain = statistics.varianceReduction && m_analogFigureOfMerit > 0 ? statistics.figureOfMerit / m_analogFigureOfMerit : 0.0;
+            emit simulationFigureOfMerit(statistics.figureOfMerit, gain);
+        }
+    }
     emit imageDataChanged(m_data);
+    if (m_historiesPerSecond > 0)
+        emit simulationThroughput(m_historiesPerSecond);
     killTimer(m_timerID);
     emit simulationRunning(false);
     emit dataProcessingFinished(ProgressWorkType::Simulating);
@@ -111,88 +258,499 @@ void SimulationPipeline::finishingSimulation()
 
 void SimulationPipeline::timerEvent(QTimerEvent* event)
 {
-    const auto [n, total] = m_progress.progress();
-    const int percent = static_cast<int>((n * 100) / total);
+    const auto status = m_runProgress.sample(m_progress);
     auto message = QString::fromStdString(m_progress.message());
-    emit this->simulationProgress(message, percent);
+    if (m_pause.isPaused()) {
+        // time spent paused does not count in throughput
+        m_runProgress.restartSampling();
+        message = tr("Paused ") + message;
+    }
+    emit this->simulationProgress(message, static_cast<int>(status.fraction * 100));
+    emit this->simulationProgressStatus(status.elapsed, status.historiesPerSecond, status.remaining);
 
     if (!m_progress.continueSimulation()) {
         finishingSimulation();
+        return;
+    }
+
+    // poll rate follows expected run length
+    const auto interval = m_runProgress.pollInterval();
+    if (std::abs(interval - m_timerInterval) > m_timerInterval / 4) {
+        killTimer(m_timerID);
+        m_timerInterval = interval;
+        m_timerID = startTimer(m_timerInterval, Qt::CoarseTimer);
     }
 }
 
-template <int CORRECTION = 1>
-void worker(bool deleteAirDose, int nthreads, std::shared_ptr<DataContainer> data, std::vector<std::shared_ptr<Beam>> beams, dxmc::TransportProgress* progress)
+struct WorkerSettings {
+    bool deleteAirDose = true;
+    bool cropAir = true;
+    bool woodcockTracking = false;
+    int nthreads = 0;
+    ThreadAffinity::ThreadPlacement threadPlacement = ThreadAffinity::ThreadPlacement::None;
+    ThreadAffinity::MemoryPlacement memoryPlacement = ThreadAffinity::MemoryPlacement::Default;
+    int doseScoringBlock = 1;
+    bool organDoseOnly = false;
+    int previewFactor = 1;
+    std::uint64_t previewHistories = 0;
+    SimulationPauseControl* pause = nullptr;
+    SimulationProgress* runProgress = nullptr;
+    bool adaptiveAllocation = false;
+    std::vector<std::string> organsOfInterest; // figure of merit is reported for these organs
+    bool varianceReduction = false; // splitting and roulette towards organs of interest
+    DataContainer::SimulationStatistics statistics; // host and settings, timings are filled by worker
+    std::vector<SimulationPipeline::SweepVariant> sweep;
+    std::vector<ICRPPhantom> batch;
+    bool batchRemoveArms = false;
+    std::shared_ptr<DataContainer>* batchResult = nullptr; // written by worker before it stops progress
+};
+
+// Memory estimate of simulating data with settings. Sweeps and batches tally organ doses only and
+// previews simulate a downsampled grid.
+SimulationMemoryEstimate estimateMemory(std::shared_ptr<const DataContainer> data, const WorkerSettings& settings)
 {
-    using VoxelGrid = dxmc::AAVoxelGrid<5, CORRECTION, 255>;
-    using World = dxmc::World<VoxelGrid>;
+    const bool preview = settings.previewFactor > 1;
+    const bool organDoseOnly = !settings.sweep.empty() || (settings.organDoseOnly && data->hasImage(DataContainer::ImageType::Organ));
+    SimulationMemoryEstimate::Parameters parameters {
+        .voxels = data->size(),
+        .simulatedVoxels = data->size(),
+        .materials = data->getMaterials().size(),
+        .woodcockTracking = settings.woodcockTracking,
+        .doseScoringBlock = preview ? 1 : settings.doseScoringBlock,
+        .organDoseOnly = organDoseOnly
+    };
+    if (preview)
+        parameters.simulatedVoxels = GridDownsample(data->dimensions(), static_cast<std::size_t>(settings.previewFactor)).size();
+    else if (settings.cropAir && data->hasImage(DataContainer::ImageType::Material))
+        parameters.simulatedVoxels = GridCrop(data->dimensions(), data->getMaterialArray()).size();
+    for (const auto* array : { &data->getDoseArray(), &data->getDoseVarianceArray(), &data->getDoseEventCountArray(), &data->getDoseDifferenceArray(), &data->getDoseRatioArray(), &data->getDoseZScoreArray() })
+        parameters.existingDoseArrays += array->size() * sizeof(double);
+    return SimulationMemoryEstimate::estimate(parameters);
+}
 
-    World world;
-    auto& vgrid = world.template addItem<VoxelGrid>();
+std::string beamName(const Beam& beam, std::size_t index)
+{
+    constexpr std::array<const char*, std::variant_size_v<Beam>> names = { "DX", "CT spiral", "CT spiral dual energy", "CBCT", "CT sequential", "Pencil" };
+    return "Beam " + std::to_string(index + 1) + " (" + names[beam.index()] + ")";
+}
 
+// Dose scored in a cropped or downsampled voxel grid, indexed by voxels in the full grid.
+// Voxels outside the simulated grid scores no dose.
+template <typename VoxelGrid, typename GridMap>
+class GridDoseScore {
+public:
+    GridDoseScore(const VoxelGrid& vgrid, const GridMap& map)
+        : m_vgrid(vgrid)
+        , m_map(map)
     {
-        std::vector<Material> materials;
-        for (const auto& materialTemplate : data->getMaterials()) {
-            auto material = Material::byWeight(materialTemplate.Z);
-            if (!material) {
-                // we failed to create material
-                progress->setStopSimulation();
-                return;
-            } else {
-                materials.push_back(material.value());
-            }
-        }
-        const auto dims = data->dimensions();
-        const auto spacing = data->spacing();
-        const auto& densityArray = data->getDensityArray();
-        const auto& materialArray = data->getMaterialArray();
-        vgrid.setData(dims, densityArray, materialArray, materials);
+    }
+    const dxmc::DoseScore& doseScored(std::size_t fullIdx) const
+    {
+        const auto idx = m_map.gridIndex(fullIdx);
+        return idx < m_map.size() ? m_vgrid.doseScored(idx) : m_empty;
+    }
+
+private:
+    const VoxelGrid& m_vgrid;
+    const GridMap& m_map;
+    dxmc::DoseScore m_empty;
+};
+
+std::optional<std::vector<Material>> setupMaterials(std::shared_ptr<DataContainer> data)
+{
+    std::vector<Material> materials;
+    for (const auto& materialTemplate : data->getMaterials()) {
+        auto material = MaterialCache::byWeight(materialTemplate.Z);
+        if (!material)
+            return std::nullopt;
+        materials.push_back(material.value());
+    }
+    return materials;
+}
+
+template <typename VoxelGrid>
+bool setupVoxelGrid(VoxelGrid& vgrid, std::shared_ptr<DataContainer> data, const GridDownsample& downsample)
+{
+    const auto materials = setupMaterials(data);
+    if (!materials)
+        return false;
+    const auto spacing = data->spacing();
+    vgrid.setData(downsample.dimensions(), downsample.downsampleDensity(data->getDensityArray()), downsample.downsampleMaterial(data->getMaterialArray()), materials.value());
+    vgrid.setSpacing(downsample.spacing(spacing));
+    vgrid.translate(downsample.offset(spacing));
+    return true;
+}
+
+template <typename VoxelGrid>
+bool setupVoxelGrid(VoxelGrid& vgrid, std::shared_ptr<DataContainer> data, const GridCrop& crop)
+{
+    const auto materials_opt = setupMaterials(data);
+    if (!materials_opt)
+        return false;
+    const auto& materials = materials_opt.value();
+    const auto spacing = data->spacing();
+    const auto& densityArray = data->getDensityArray();
+    const auto& materialArray = data->getMaterialArray();
+    if (crop.isCropped()) {
+        vgrid.setData(crop.dimensions(), crop.crop(densityArray), crop.crop(materialArray), materials);
+        vgrid.setSpacing(spacing);
+        vgrid.translate(crop.offset(spacing));
+    } else {
+        vgrid.setData(data->dimensions(), densityArray, materialArray, materials);
         vgrid.setSpacing(spacing);
     }
+    return true;
+}
 
-    world.build();
+// Dose scored by a voxel grid in blocks of block^3 voxels, the voxel grid covers the cropped region
+// and its blocks are aligned with blocks of the full grid. Scores are looked up by voxels or by blocks
+// of the full grid, blocks outside the simulated grid scores no dose.
+template <typename VoxelGrid>
+class GridBlockDoseScore {
+public:
+    GridBlockDoseScore(const VoxelGrid& vgrid, const std::array<std::size_t, 3>& dim, const GridCrop& crop)
+        : m_vgrid(vgrid)
+        , m_dim(dim)
+        , m_block(vgrid.doseScoringBlock())
+    {
+        for (std::size_t i = 0; i < 3; ++i) {
+            m_bdim[i] = (m_dim[i] + m_block - 1) / m_block;
+            m_blo[i] = crop.lower()[i] / m_block;
+        }
+    }
+    std::size_t block() const { return m_block; }
+    const dxmc::DoseScore& doseScored(std::size_t fullIdx) const
+    {
+        const auto x = fullIdx % m_dim[0];
+        const auto y = (fullIdx / m_dim[0]) % m_dim[1];
+        const auto z = fullIdx / (m_dim[0] * m_dim[1]);
+        return blockScored(x / m_block + m_bdim[0] * (y / m_block + m_bdim[1] * (z / m_block)));
+    }
+    const dxmc::DoseScore& blockScored(std::size_t blockIdx) const
+    {
+        const std::array<std::size_t, 3> b = { blockIdx % m_bdim[0], (blockIdx / m_bdim[0]) % m_bdim[1], blockIdx / (m_bdim[0] * m_bdim[1]) };
+        const auto& gdim = m_vgrid.doseScoringDimensions();
+        std::array<std::size_t, 3> g;
+        for (std::size_t i = 0; i < 3; ++i) {
+            if (b[i] < m_blo[i] || b[i] - m_blo[i] >= gdim[i])
+                return m_empty;
+            g[i] = b[i] - m_blo[i];
+        }
+        return m_vgrid.doseScored(g[0] + gdim[0] * (g[1] + gdim[1] * g[2]));
+    }
 
-    dxmc::Transport transport;
-    if (nthreads > 0)
-        transport.setNumberOfThreads(nthreads);
+private:
+    const VoxelGrid& m_vgrid;
+    std::array<std::size_t, 3> m_dim;
+    std::array<std::size_t, 3> m_bdim = { 1, 1, 1 };
+    std::array<std::size_t, 3> m_blo = { 0, 0, 0 };
+    std::size_t m_block = 1;
+    dxmc::DoseScore m_empty;
+};
 
-    const int Njobs = beams.size();
+// Tallies dose directly per organ label with chunked accumulators, no voxel arrays are allocated.
+// Material labels and names may be used in place of organs.
+template <typename VoxelGrid>
+std::vector<DataContainer::OrganDose> collectOrganDose(const VoxelGrid& vgrid, std::shared_ptr<DataContainer> data, const std::vector<std::uint8_t>& organArray, const std::vector<std::string>& organNames)
+{
+    const auto voxelVolume = std::reduce(data->spacing().cbegin(), data->spacing().cend(), 1.0, std::multiplies {});
+    const auto total = accumulateOrgans(organArray, data->getDensityArray(), voxelVolume, {}, [&vgrid](const std::size_t i) {
+        const auto& score = vgrid.doseScored(i);
+        return VoxelDose { .dose = score.dose(), .variance = score.variance(), .events = static_cast<double>(score.numberOfEvents()) };
+    });
 
-    for (int jobIdx = 0; jobIdx < Njobs; jobIdx++) {
-        const auto& currentbeam = *(beams[jobIdx]);
-        std::visit(
-            [&](auto&& beam) {
-                transport(world, beam, progress, true);
-            },
-            currentbeam);
+    std::vector<DataContainer::OrganDose> res;
+    for (std::size_t o = 0; o < std::min(organNames.size(), total.size()); ++o) {
+        const auto& acc = total[o];
+        if (acc.voxels == 0)
+            continue;
+        DataContainer::OrganDose organ;
+        organ.name = organNames[o];
+        organ.voxels = acc.voxels;
+        organ.volume = acc.voxels * voxelVolume;
+        organ.mass = acc.mass;
+        if (acc.mass > 0) {
+            organ.dose = acc.energy / acc.mass;
+            organ.variance = acc.variance / (acc.mass * acc.mass);
+        }
+        organ.events = acc.events;
+        res.push_back(organ);
+    }
+    return res;
+}
+
+std::uint64_t numberOfHistories(const Beam& beam)
+{
+    return std::visit([](const auto& b) { return b.numberOfExposures() * b.numberOfParticlesPerExposure(); }, beam);
+}
+
+std::uint64_t numberOfHistories(const std::vector<std::shared_ptr<Beam>>& beams)
+{
+    std::uint64_t total = 0;
+    for (const auto& beam : beams)
+        total += numberOfHistories(*beam);
+    return total;
+}
+
+// Copies of beams with number of particles reduced to a total of about maxHistories
+std::vector<std::shared_ptr<Beam>> previewBeams(const std::vector<std::shared_ptr<Beam>>& beams, std::uint64_t maxHistories)
+{
+    const auto total = numberOfHistories(beams);
+    const auto scale = total > maxHistories ? static_cast<double>(maxHistories) / total : 1.0;
+
+    std::vector<std::shared_ptr<Beam>> res;
+    for (const auto& beam : beams) {
+        auto copy = std::make_shared<Beam>(*beam);
+        std::visit([scale](auto& b) {
+            const auto n = static_cast<std::uint64_t>(std::round(b.numberOfParticlesPerExposure() * scale));
+            b.setNumberOfParticlesPerExposure(std::max(n, std::uint64_t { 1 }));
+        },
+            *copy);
+        res.push_back(copy);
+    }
+    return res;
+}
+
+// Redistributes histories between beams to minimize the summed voxel dose variance for the CPU time
+// the original allocation would use. A pilot batch of each beam estimates the variance per history v_b
+// and CPU time per history c_b, optimal allocation is then N_b proportional to sqrt(v_b / c_b).
+// The pilot tallies are discarded and its time is subtracted from the budget.
+template <typename World, typename VoxelGrid>
+std::vector<std::shared_ptr<Beam>> adaptiveBeamAllocation(World& world, const VoxelGrid& vgrid, dxmc::Transport& transport, const std::vector<std::shared_ptr<Beam>>& beams, dxmc::TransportProgress* progress, SimulationProgress* runProgress)
+{
+    constexpr double pilotFraction = 0.05;
+
+    std::vector<double> variancePerHistory(beams.size(), 0);
+    std::vector<double> timePerHistory(beams.size(), 0);
+    double budget = 0;
+    for (std::size_t b = 0; b < beams.size(); ++b) {
+        auto pilot = *beams[b];
+        std::visit([&](auto& beam) {
+            const auto histories = beam.numberOfExposures() * beam.numberOfParticlesPerExposure();
+            const auto n = static_cast<std::uint64_t>(std::ceil(beam.numberOfParticlesPerExposure() * pilotFraction));
+            beam.setNumberOfParticlesPerExposure(std::max(n, std::uint64_t { 1 }));
+            const auto pilotHistories = beam.numberOfExposures() * beam.numberOfParticlesPerExposure();
+
+            if (runProgress) {
+                runProgress->addPlannedHistories(static_cast<std::int64_t>(pilotHistories));
+                runProgress->beginTransport(pilotHistories);
+            }
+            const auto start = std::chrono::steady_clock::now();
+            transport(world, beam, progress, true);
+            const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+            if (runProgress)
+                runProgress->endTransport();
+
+            double variance = 0;
+            for (std::size_t i = 0; i < vgrid.size(); ++i)
+                variance += vgrid.doseScored(i).variance();
+            variancePerHistory[b] = variance * pilotHistories;
+            timePerHistory[b] = time.count() / pilotHistories;
+            budget += (histories - pilotHistories) * timePerHistory[b];
+        },
+            pilot);
+        world.clearDoseScored();
+        if (!progress->continueSimulation())
+            return beams;
+    }
+
+    double norm = 0;
+    for (std::size_t b = 0; b < beams.size(); ++b)
+        norm += std::sqrt(variancePerHistory[b] * timePerHistory[b]);
+    if (norm <= 0 || budget <= 0)
+        return beams;
+
+    std::vector<std::shared_ptr<Beam>> res;
+    for (std::size_t b = 0; b < beams.size(); ++b) {
+        auto copy = std::make_shared<Beam>(*beams[b]);
+        const auto histories = timePerHistory[b] > 0 ? budget * std::sqrt(variancePerHistory[b] / timePerHistory[b]) / norm : 0.0;
+        std::visit([histories](auto& beam) {
+            const auto n = static_cast<std::uint64_t>(histories / std::max(beam.numberOfExposures(), std::uint64_t { 1 }));
+            beam.setNumberOfParticlesPerExposure(std::max(n, std::uint64_t { 1 }));
+        },
+            *copy);
+        res.push_back(copy);
+    }
+    if (runProgress)
+        runProgress->addPlannedHistories(static_cast<std::int64_t>(numberOfHistories(res)) - static_cast<std::int64_t>(numberOfHistories(beams)));
+    return res;
+}
+
+// Number of passes each beam is split into, a running simulation can only be paused between passes
+int numberOfTransportPasses(const std::vector<std::shared_ptr<Beam>>& beams)
+{
+    constexpr std::uint64_t maxPasses = 10;
+    std::uint64_t passes = maxPasses;
+    for (const auto& beam : beams)
+        passes = std::min(passes, std::visit([](const auto& b) { return b.numberOfParticlesPerExposure(); }, *beam));
+    return static_cast<int>(std::max(passes, std::uint64_t { 1 }));
+}
+
+// Copy of the base beam with the parameters set in variant
+Beam applySweepVariant(const Beam& base, const SimulationPipeline::SweepVariant& variant)
+{
+    auto beam = base;
+    std::visit([&](auto& b) {
+        if constexpr (requires { b.setTubeVoltage(1.0); }) {
+            if (variant.tubeVoltage)
+                b.setTubeVoltage(variant.tubeVoltage.value());
+        }
+        if constexpr (requires { b.addTubeFiltrationMaterial(13, 1.0); }) {
+            if (variant.aluminumFiltration)
+                b.addTubeFiltrationMaterial(13, variant.aluminumFiltration.value());
+        }
+        if constexpr (requires { b.setPitch(1.0); }) {
+            if (variant.pitch)
+                b.setPitch(variant.pitch.value());
+        }
+        if constexpr (requires { b.setCollimation(1.0); }) {
+            if (variant.collimation)
+                b.setCollimation(variant.collimation.value());
+        }
+    },
+        beam);
+    return beam;
+}
+
+// Runs each variant of the base beam in the same world, dose scored is cleared between variants.
+// Only organ doses (or material doses when no organs are present) are kept for each variant.
 
+template <typename World, typename DoseView>
+void runSweep(World& world, const DoseView& scored, dxmc::Transport& transport, const Beam& base, const WorkerSettings& settings, std::shared_ptr<DataContainer> data, dxmc::TransportProgress* progress)
+{
+    std::vector<std::uint8_t> labels;
+    std::vector<std::string> names;
+    const bool organs = data->hasImage(DataContainer::ImageType::Organ);
+    if (!organs) {
+        for (const auto& m : data->getMaterials())
+            names.push_back(m.name);
+    }
+    const auto& labelArray = organs ? data->getOrganArray() : data->getMaterialArray();
+    const auto& labelNames = organs ? data->getOrganNames() : names;
+
+    std::vector<DataContainer::SweepResult> results;
+    for (const auto& variant : settings.sweep) {
+        if (settings.pause)
+            settings.pause->waitWhilePaused(*progress);
+        if (!progress->continueSimulation())
+            return;
+        world.clearDoseScored();
+        auto beam = applySweepVariant(base, variant);
+        if (settings.runProgress)
+            settings.runProgress->beginTransport(numberOfHistories(beam));
+        std::visit([&](auto& b) { transport(world, b, progress, true); }, beam);
+        if (settings.runProgress)
+            settings.runProgress->endTransport();
         if (!progress->continueSimulation())
             return;
+        results.push_back({ .name = variant.name, .doses = collectOrganDose(scored, data, labelArray, labelNames) });
     }
 
+    data->removeImage(DataContainer::ImageType::Dose);
+    data->removeImage(DataContainer::ImageType::DoseVariance);
+    data->removeImage(DataContainer::ImageType::DoseCount);
+    data->removeDoseComparisonImages();
+    data->setDoseUnits("mGy");
+    data->setDosePreview(false);
+    data->setOrganDoses({});
+    data->setSweepResults(results);
+}
+
+// Mask of voxels in organs of interest, empty if none of the organs are present
+std::vector<std::uint8_t> organsOfInterestMask(std::shared_ptr<DataContainer> data, const std::vector<std::string>& organsOfInterest)
+{
+    if (organsOfInterest.empty() || !data->hasImage(DataContainer::ImageType::Organ))
+        return {};
+    std::array<std::uint8_t, 256> interest = {};
+    bool any = false;
+    const auto& organNames = data->getOrganNames();
+    for (std::size_t i = 0; i < std::min(organNames.size(), interest.size()); ++i)
+        if (std::find(organsOfInterest.cbegin(), organsOfInterest.cend(), organNames[i]) != organsOfInterest.cend()) {
+            interest[i] = 1;
+            any = true;
+        }
+    if (!any)
+        return {};
+    const auto& organArray = data->getOrganArray();
+    std::vector<std::uint8_t> mask(organArray.size());
+    std::transform(std::execution::par_unseq, organArray.cbegin(), organArray.cend(), mask.begin(), [&](const auto o) { return interest[o]; });
+    return mask;
+}
+
+// Figure of merit 1 / (R^2 T) of the least precise organ of interest, where R is the relative
+// standard error of organ dose and T is transport time.
+template <typename DoseView>
+double organsOfInterestFigureOfMerit(const DoseView& scored, std::shared_ptr<DataContainer> data, const std::vector<std::string>& organsOfInterest, double time)
+{
+    if (organsOfInterest.empty() || time <= 0 || !data->hasImage(DataContainer::ImageType::Organ))
+        return 0;
+    const auto organs = collectOrganDose(scored, data, data->getOrganArray(), data->getOrganNames());
+    double fom = 0;
+    for (const auto& organ : organs) {
+        if (std::find(organsOfInterest.cbegin(), organsOfInterest.cend(), organ.name) == organsOfInterest.cend())
+            continue;
+        if (organ.dose <= 0 || organ.variance <= 0)
+            return 0;
+        const auto organFom = organ.dose * organ.dose / (organ.variance * time);
+        fom = fom > 0 ? std::min(fom, organFom) : organFom;
+    }
+    return fom;
+}
+
+// Dose scored in each transport pass is an estimate of the full beam dose, hence the sum
+// over passes is scaled by doseScale = 1/passes and variance by doseScale^2.
+template <typename DoseView>
+void collectDose(const DoseView& scored, const WorkerSettings& settings, std::shared_ptr<DataContainer> data, double doseScale = 1)
+{
+    const bool deleteAirDose = settings.deleteAirDose;
+    data->setSweepResults({});
+    // comparison maps against a reference dose are stale when dose is replaced
+    data->removeDoseComparisonImages();
+
+    if (settings.organDoseOnly && data->hasImage(DataContainer::ImageType::Organ)) {
+        data->removeImage(DataContainer::ImageType::Dose);
+        data->removeImage(DataContainer::ImageType::DoseVariance);
+        data->removeImage(DataContainer::ImageType::DoseCount);
+        data->setDoseUnits("mGy");
+        auto organDoses = collectOrganDose(scored, data, data->getOrganArray(), data->getOrganNames());
+        for (auto& organ : organDoses) {
+            organ.dose *= doseScale;
+            organ.variance *= doseScale * doseScale;
+        }
+        data->setOrganDoses(organDoses);
+        return;
+    }
+    data->setOrganDoses({});
+
+    // Dose images are stored per block if dose is scored in blocks
+    std::size_t block = 1;
+    if constexpr (requires { scored.blockScored(std::size_t { 0 }); })
+        block = scored.block();
+    data->setDoseScoringBlock(block);
+    const auto score = [&](const std::size_t i) -> const dxmc::DoseScore& {
+        if constexpr (requires { scored.blockScored(std::size_t { 0 }); })
+            return scored.blockScored(i);
+        else
+            return scored.doseScored(i);
+    };
+
     // collect dose
-    const auto N = vgrid.size();
+    const auto N = data->doseSize();
+    // Tallies are kept in air, dose to air is only masked when viewed
+    data->setAirMasked(deleteAirDose);
     {
+        const auto& airMask = data->doseAirMask();
+        const bool masked = data->isAirMasked();
         std::vector<double> dose(N);
-        for (std::size_t i = 0; i < N; ++i)
-            dose[i] = vgrid.doseScored(i).dose();
-
-        if (deleteAirDose) {
-            const auto matarr = data->getMaterialArray();
-            std::transform(std::execution::par_unseq, dose.cbegin(), dose.cend(), matarr.cbegin(), dose.begin(), [](const auto d, const auto m) {
-                return m > 0 ? d : 0.0;
-            });
+        double maxDose = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            dose[i] = score(i).dose() * doseScale;
+            if (!masked || !airMask[i])
+                maxDose = std::max(maxDose, dose[i]);
         }
 
-        const auto& max_idx = std::max_element(std::execution::par_unseq, dose.cbegin(), dose.cend());
-        if (*max_idx < 1) {
-            std::transform(std::execution::par_unseq, dose.cbegin(), dose.cend(), dose.begin(), [](const auto d) {
-                return d * 1e3;
-            });
-            data->setDoseUnits("uGy");
-        } else {
-            data->setDoseUnits("mGy");
-        }
+        // dose is kept in mGy, low doses are only displayed in uGy
+        data->setDoseUnits(maxDose < 1 ? "uGy" : "mGy");
 
         data->setImageArray(DataContainer::ImageType::Dose, dose);
     }
@@ -201,14 +759,7 @@ void worker(bool deleteAirDose, int nthreads, std::shared_ptr<DataContainer> dat
     {
         std::vector<double> dose_count_array(N, 0);
         for (std::size_t i = 0; i < N; ++i)
-            dose_count_array[i] = static_cast<double>(vgrid.doseScored(i).numberOfEvents());
-
-        if (deleteAirDose) {
-            const auto matarr = data->getMaterialArray();
-            std::transform(std::execution::par_unseq, dose_count_array.cbegin(), dose_count_array.cend(), matarr.cbegin(), dose_count_array.begin(), [](const auto d, const auto m) {
-                return m > 0 ? d : 0;
-            });
-        }
+            dose_count_array[i] = static_cast<double>(score(i).numberOfEvents());
         data->setImageArray(DataContainer::ImageType::DoseCount, dose_count_array);
     }
 
@@ -216,47 +767,595 @@ void worker(bool deleteAirDose, int nthreads, std::shared_ptr<DataContainer> dat
     {
         std::vector<double> dose_var(N, 0.0);
         for (std::size_t i = 0; i < N; ++i)
-            dose_var[i] = vgrid.doseScored(i).variance();
+            dose_var[i] = score(i).variance() * doseScale * doseScale;
+        data->setImageArray(DataContainer::ImageType::DoseVariance, dose_var);
+    }
+}
 
-        if (deleteAirDose) {
-            const auto matarr = data->getMaterialArray();
-            std::transform(std::execution::par_unseq, dose_var.cbegin(), dose_var.cend(), matarr.cbegin(), dose_var.begin(), [](const auto d, const auto m) {
-                return m > 0 ? d : 0.0;
-            });
-        }
-        if (data->units(DataContainer::ImageType::Dose)[0] == 'u') {
-            std::for_each(std::execution::par_unseq, dose_var.begin(), dose_var.end(), [](auto& v) { v *= 1e6; });
+template <typename VoxelGrid>
+bool simulate(WorkerSettings settings, std::shared_ptr<DataContainer> data, std::vector<std::shared_ptr<Beam>> beams, dxmc::TransportProgress* progress, double* historiesPerSecond)
+{
+    using World = dxmc::World<VoxelGrid>;
+
+    const int nthreads = settings.nthreads;
+    const bool preview = settings.previewFactor > 1;
+
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+    const auto wall_start = Clock::now();
+    auto statistics = settings.statistics;
+
+    // Threads started by transport inherits the cpu mask of this thread. Memory for the world is
+    // allocated and first touched by this thread, hence we bind it before building the world.
+    const int nthreads_used = nthreads > 0 ? nthreads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const auto cpus = ThreadAffinity::selectCpus(settings.threadPlacement, nthreads_used);
+    if (settings.memoryPlacement == ThreadAffinity::MemoryPlacement::FirstTouch) {
+        const auto placement = settings.threadPlacement == ThreadAffinity::ThreadPlacement::None ? ThreadAffinity::ThreadPlacement::Compact : settings.threadPlacement;
+        ThreadAffinity::bindCurrentThread(ThreadAffinity::selectCpus(placement, nthreads_used));
+    } else if (settings.threadPlacement != ThreadAffinity::ThreadPlacement::None) {
+        ThreadAffinity::bindCurrentThread(cpus);
+    }
+    // interleaving fails on kernels without NUMA support, memory is then placed by first touch of this thread
+    const bool interleaved = settings.memoryPlacement == ThreadAffinity::MemoryPlacement::Interleaved
+        && ThreadAffinity::setMemoryPlacement(settings.memoryPlacement, ThreadAffinity::nodesForCpus(cpus));
+
+    // Air surrounding the body is cropped independent of masking of air dose, which is only a view
+    const auto crop = settings.cropAir && !preview ? GridCrop(data->dimensions(), data->getMaterialArray()) : GridCrop(data->dimensions());
+    const GridDownsample downsample(data->dimensions(), static_cast<std::size_t>(std::max(settings.previewFactor, 1)));
+
+    const auto build_start = Clock::now();
+    World world;
+    auto& vgrid = world.template addItem<VoxelGrid>();
+
+    const bool valid = preview ? setupVoxelGrid(vgrid, data, downsample) : setupVoxelGrid(vgrid, data, crop);
+    if (!valid) {
+        // we failed to create material
+        return false;
+    }
+
+    // Dose is scored in blocks by voxel grids supporting it, organ doses of sweeps and organ dose only
+    // runs are tallied per voxel
+    const bool organDoseOnly = settings.organDoseOnly && data->hasImage(DataContainer::ImageType::Organ);
+    bool blockScoring = false;
+    if constexpr (requires { vgrid.setDoseScoringBlock(std::size_t { 1 }, std::array<std::size_t, 3> {}); }) {
+        blockScoring = !preview && !organDoseOnly && settings.sweep.empty() && settings.doseScoringBlock > 1;
+        if (blockScoring)
+            vgrid.setDoseScoringBlock(static_cast<std::size_t>(settings.doseScoringBlock), crop.lower());
+    }
+
+    if constexpr (requires { vgrid.setImportance(std::vector<std::uint8_t> {}); }) {
+        const auto mask = settings.varianceReduction ? organsOfInterestMask(data, settings.organsOfInterest) : std::vector<std::uint8_t> {};
+        if (!mask.empty())
+            vgrid.setImportance(preview ? downsample.downsampleMaterial(mask) : crop.crop(mask));
+        statistics.varianceReduction = vgrid.hasImportance();
+    }
+
+    world.build();
+    statistics.worldBuildTime = Seconds(Clock::now() - build_start).count();
+    statistics.threads = nthreads_used;
+
+    if (interleaved)
+        ThreadAffinity::resetMemoryPlacement();
+    if (settings.memoryPlacement == ThreadAffinity::MemoryPlacement::FirstTouch) {
+        if (settings.threadPlacement == ThreadAffinity::ThreadPlacement::None)
+            ThreadAffinity::unbindCurrentThread();
+        else
+            ThreadAffinity::bindCurrentThread(cpus);
+    }
+
+    dxmc::Transport transport;
+    if (nthreads > 0)
+        transport.setNumberOfThreads(nthreads);
+
+    if (!settings.sweep.empty()) {
+        runSweep(world, GridDoseScore(vgrid, crop), transport, *beams.front(), settings, data, progress);
+        return progress->continueSimulation();
+    }
+
+    if (preview)
+        beams = previewBeams(beams, settings.previewHistories);
+    else if (settings.adaptiveAllocation && beams.size() > 1) {
+        const auto pilot_start = Clock::now();
+        beams = adaptiveBeamAllocation(world, vgrid, transport, beams, progress, settings.runProgress);
+        statistics.pilotTime = Seconds(Clock::now() - pilot_start).count();
+        // stopped during pilot runs
+        if (!progress->continueSimulation())
+            return false;
+    }
+
+    const int Njobs = beams.size();
+    const int Npasses = numberOfTransportPasses(beams);
+
+    std::uint64_t histories = 0;
+    std::chrono::duration<double> transport_time(0);
+    statistics.beams.resize(Njobs);
+    for (int jobIdx = 0; jobIdx < Njobs; jobIdx++) {
+        auto& beamStatistics = statistics.beams[jobIdx];
+        beamStatistics.name = beamName(*beams[jobIdx], jobIdx);
+        for (int pass = 0; pass < Npasses; ++pass) {
+            if (settings.pause) {
+                settings.pause->waitWhilePaused(*progress);
+                if (!progress->continueSimulation())
+                    return false;
+            }
+            // Particles per exposure is distributed over passes
+            auto currentbeam = *(beams[jobIdx]);
+            std::visit(
+                [&](auto&& beam) {
+                    const auto n = beam.numberOfParticlesPerExposure();
+                    beam.setNumberOfParticlesPerExposure(n / Npasses + (static_cast<std::uint64_t>(pass) < n % Npasses ? 1 : 0));
+                    const auto beamHistories = beam.numberOfExposures() * beam.numberOfParticlesPerExposure();
+                    if (settings.runProgress)
+                        settings.runProgress->beginTransport(beamHistories);
+                    const auto start = Clock::now();
+                    transport(world, beam, progress, true);
+                    const Seconds time = Clock::now() - start;
+                    if (settings.runProgress)
+                        settings.runProgress->endTransport();
+                    transport_time += time;
+                    histories += beamHistories;
+                    beamStatistics.transportTime += time.count();
+                    beamStatistics.histories += beamHistories;
+                },
+                currentbeam);
+
+            if (!progress->continueSimulation())
+                return false;
         }
+    }
+    if (transport_time.count() > 0 && !preview)
+        *historiesPerSecond = histories / transport_time.count();
 
-        data->setImageArray(DataContainer::ImageType::DoseVariance, dose_var);
+    const auto finish = [&](const auto& scored) {
+        statistics.figureOfMerit = organsOfInterestFigureOfMerit(scored, data, settings.organsOfInterest, transport_time.count());
+        data->setDosePreview(preview);
+        const auto collect_start = Clock::now();
+        collectDose(scored, settings, data, 1.0 / Npasses);
+        statistics.doseCollectionTime = Seconds(Clock::now() - collect_start).count();
+    };
+    if (preview)
+        finish(GridDoseScore(vgrid, downsample));
+    else if (!blockScoring)
+        finish(GridDoseScore(vgrid, crop));
+    else if constexpr (requires { vgrid.doseScoringBlock(); })
+        finish(GridBlockDoseScore(vgrid, data->dimensions(), crop));
+
+    statistics.transportTime = transport_time.count();
+    statistics.histories = histories;
+    statistics.wallTime = Seconds(Clock::now() - wall_start).count();
+    data->setSimulationStatistics(statistics);
+
+    return true;
+}
+
+// Body extent along z as center and length
+std::pair<double, double> bodyExtent(std::shared_ptr<DataContainer> data)
+{
+    const GridCrop crop(data->dimensions(), data->getMaterialArray());
+    const auto& spacing = data->spacing();
+    return { crop.offset(spacing)[2], crop.dimensions()[2] * spacing[2] };
+}
+
+// Copies of beams with CT scan ranges, DX rotation centers and CBCT isocenters mapped along z from
+// the body extent of the reference phantom to the body extent of phantom, such that the beams
+// cover the same anatomy. Field sizes are kept and pencil beams are not moved.
+std::vector<std::shared_ptr<Beam>> scaleBeamsToPhantom(const std::vector<std::shared_ptr<Beam>>& beams, std::shared_ptr<DataContainer> reference, std::shared_ptr<DataContainer> phantom)
+{
+    if (!reference || !reference->hasImage(DataContainer::ImageType::Material))
+        return beams;
+    const auto [ref_center, ref_length] = bodyExtent(reference);
+    const auto [center, length] = bodyExtent(phantom);
+    if (ref_length <= 0)
+        return beams;
+    const auto scale = length / ref_length;
+    auto mapz = [&](std::array<double, 3> pos) {
+        pos[2] = center + (pos[2] - ref_center) * scale;
+        return pos;
+    };
+
+    std::vector<std::shared_ptr<Beam>> res;
+    for (const auto& beam : beams) {
+        auto copy = std::make_shared<Beam>(*beam);
+        std::visit([&](auto& b) {
+            using T = std::decay_t<decltype(b)>;
+            if constexpr (std::is_same_v<T, CTSpiralBeam> || std::is_same_v<T, CTSpiralDualEnergyBeam>) {
+                const auto start = mapz(b.startPosition());
+                const auto stop = mapz(b.stopPosition());
+                b.setStartPosition(start);
+                b.setStopPosition(stop);
+            } else if constexpr (std::is_same_v<T, CTSequentialBeam>) {
+                b.setPosition(mapz(b.position()));
+            } else if constexpr (std::is_same_v<T, DXBeam>) {
+                b.setRotationCenter(mapz(b.rotationCenter()));
+            } else if constexpr (std::is_same_v<T, CBCTBeam>) {
+                b.setIsocenter(mapz(b.isocenter()));
+            }
+        },
+            *copy);
+        res.push_back(copy);
     }
+    return res;
+}
+
+// Simulates beams on each phantom in turn, reading of the next phantom runs concurrently with
+// simulation of the current. Only organ doses are tallied. The last phantom is returned with
+// organ doses of all phantoms as sweep results, one result for each phantom. Phantoms that will not fit in memory are skipped
+// and listed without doses.
+template <typename VoxelGrid>
+void batchSimulate(WorkerSettings settings, std::shared_ptr<DataContainer> reference, std::vector<std::shared_ptr<Beam>> beams, dxmc::TransportProgress* progress)
+{
+    settings.organDoseOnly = true;
+    const auto& phantoms = settings.batch;
+    auto read = [removeArms = settings.batchRemoveArms](const ICRPPhantom& phantom) {
+        return ICRPPhantomImportPipeline::readPhantom(phantom, removeArms);
+    };
+
+    std::vector<DataContainer::SweepResult> results;
+    std::shared_ptr<DataContainer> last = nullptr;
+    auto next = std::async(std::launch::async, read, phantoms.front());
+    for (std::size_t k = 0; k < phantoms.size(); ++k) {
+        auto data = next.get();
+        if (k + 1 < phantoms.size())
+            next = std::async(std::launch::async, read, phantoms[k + 1]);
+        if (!data || !data->hasImage(DataContainer::ImageType::Organ))
+            continue;
+        if (!estimateMemory(data, settings).fitsInMemory()) {
+            results.push_back({ .name = phantoms[k].name.toStdString() + " (does not fit in memory)" });
+            continue;
+        }
+        double historiesPerSecond = 0;
+        if (!simulate<VoxelGrid>(settings, data, scaleBeamsToPhantom(beams, reference, data), progress, &historiesPerSecond))
+            break;
+        results.push_back({ .name = phantoms[k].name.toStdString(), .doses = data->getOrganDoses() });
+        last = data;
+    }
+    if (last && settings.batchResult) {
+        last->setSweepResults(results);
+        *settings.batchResult = last;
+    }
+}
 
+template <typename VoxelGrid>
+void worker(WorkerSettings settings, std::shared_ptr<DataContainer> data, std::vector<std::shared_ptr<Beam>> beams, dxmc::TransportProgress* progress, double* historiesPerSecond)
+{
+    if (!settings.batch.empty())
+        batchSimulate<VoxelGrid>(settings, data, beams, progress);
+    else
+        simulate<VoxelGrid>(settings, data, beams, progress, historiesPerSecond);
     progress->setStopSimulation();
 }
 
+template <int CORRECTION = 1>
+void launchWorker(SimulationPipeline::WorldItemType type, WorkerSettings settings, std::shared_ptr<DataContainer> data, std::vector<std::shared_ptr<Beam>> beams, dxmc::TransportProgress* progress, double* historiesPerSecond)
+{
+    auto launch = [&](auto w) {
+        std::jthread t(w, settings, data, beams, progress, historiesPerSecond);
+        t.detach();
+    };
+    if (type == SimulationPipeline::WorldItemType::WoodcockVoxelGrid) {
+        // specializations for segmented CT (five materials) and small phantoms
+        const auto nmaterials = data && settings.batch.empty() ? data->getMaterials().size() : 256;
+        if (nmaterials <= 8)
+            launch(worker<WoodcockVoxelGrid<5, CORRECTION, 8>>);
+        else if (nmaterials <= 32)
+            launch(worker<WoodcockVoxelGrid<5, CORRECTION, 32>>);
+        else
+            launch(worker<WoodcockVoxelGrid<5, CORRECTION>>);
+    } else {
+        launch(worker<dxmc::AAVoxelGrid<5, CORRECTION, 255>>);
+    }
+}
+
 void SimulationPipeline::startSimulation()
 {
-    emit dataProcessingStarted(ProgressWorkType::Simulating);
-    emit simulationRunning(true);
-    m_timerID = startTimer(3000, Qt::VeryCoarseTimer);
+    runSimulation(false);
+}
 
-    if (!testIfReadyForSimulation(true)) {
-        emit simulationRunning(false);
+std::vector<double> parseSweepValues(const QString& values)
+{
+    std::vector<double> res;
+    for (const auto& v : values.split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const auto d = v.trimmed().toDouble(&ok);
+        if (ok)
+            res.push_back(d);
+    }
+    return res;
+}
+
+std::vector<SimulationPipeline::SweepVariant> SimulationPipeline::sweepVariants(const QString& tubeVoltage, const QString& aluminumFiltration, const QString& pitch, const QString& collimation)
+{
+    // an empty list keeps the value of the base beam
+    auto options = [](const QString& values) {
+        std::vector<std::optional<double>> res;
+        for (const auto v : parseSweepValues(values))
+            res.push_back(v);
+        if (res.empty())
+            res.push_back(std::nullopt);
+        return res;
+    };
+    const auto kv = options(tubeVoltage);
+    const auto al = options(aluminumFiltration);
+    const auto pi = options(pitch);
+    const auto co = options(collimation);
+
+    std::vector<SweepVariant> variants;
+    for (const auto& k : kv)
+        for (const auto& a : al)
+            for (const auto& p : pi)
+                for (const auto& c : co) {
+                    SweepVariant v { .tubeVoltage = k, .aluminumFiltration = a, .pitch = p, .collimation = c };
+                    QStringList parts;
+                    if (k)
+                        parts.append(QString::number(k.value()) + " kV");
+                    if (a)
+                        parts.append(QString::number(a.value()) + " mm Al");
+                    if (p)
+                        parts.append("pitch " + QString::number(p.value()));
+                    if (c)
+                        parts.append(QString::number(c.value()) + " cm");
+                    v.name = parts.isEmpty() ? std::string("Base beam") : parts.join(", ").toStdString();
+                    variants.push_back(v);
+                }
+    return variants;
+}
+
+void SimulationPipeline::startSweep(QString tubeVoltage, QString aluminumFiltration, QString pitch, QString collimation)
+{
+    runSimulation(false, sweepVariants(tubeVoltage, aluminumFiltration, pitch, collimation));
+}
+
+void SimulationPipeline::startPreviewSimulation()
+{
+    runSimulation(true);
+}
+
+void SimulationPipeline::startBatchSimulation(std::vector<ICRPPhantom> phantoms, bool removeArms)
+{
+    if (!phantoms.empty() && !m_beams.empty())
+        runSimulation(false, {}, phantoms, removeArms);
+}
+
+void SimulationPipeline::runSimulation(bool preview, const std::vector<SweepVariant>& sweep, const std::vector<ICRPPhantom>& batch, bool batchRemoveArms)
+{
+    const bool isBatch = !batch.empty();
+    if (!isBatch && !testIfReadyForSimulation(true))
         return;
+
+    WorkerSettings settings {
+        .deleteAirDose = m_deleteAirDose,
+        .cropAir = m_cropAir,
+        .woodcockTracking = m_worldItemType == WorldItemType::WoodcockVoxelGrid,
+        .nthreads = m_threads > 0 ? m_threads : m_autoThreads,
+        .threadPlacement = m_threadPlacement,
+        .memoryPlacement = m_memoryPlacement,
+        .doseScoringBlock = m_doseScoringBlock,
+        .organDoseOnly = m_organDoseOnly,
+        .pause = &m_pause,
+        .runProgress = &m_runProgress,
+        .adaptiveAllocation = m_adaptiveAllocation,
+        .organsOfInterest = m_organsOfInterest,
+        .varianceReduction = m_varianceReduction,
+        .sweep = sweep,
+        .batch = batch,
+        .batchRemoveArms = batchRemoveArms,
+        .batchResult = &m_batchResult
+    };
+    settings.statistics.version = APP_VERSION;
+    settings.statistics.host = QSysInfo::machineHostName().toStdString();
+    settings.statistics.cpuArchitecture = QSysInfo::currentCpuArchitecture().toStdString();
+    settings.statistics.operatingSystem = QSysInfo::prettyProductName().toStdString();
+    settings.statistics.trackingMethod = m_worldItemType == WorldItemType::WoodcockVoxelGrid ? "Woodcock delta tracking" : "Voxel tracking";
+    settings.statistics.logicalCpus = static_cast<int>(std::thread::hardware_concurrency());
+    settings.statistics.correctionLevel = m_lowenergyCorrection;
+    if (preview) {
+        // Large grids are downsampled by 4, aiming for a preview grid of a few million voxels
+        constexpr std::size_t maxPreviewVoxels = 4000000;
+        settings.previewFactor = m_data->size() / 8 > maxPreviewVoxels ? 4 : 2;
+        settings.previewHistories = 2000000;
+        settings.doseScoringBlock = 1;
     }
+
+    if (!isBatch) {
+        // refuse to start a simulation that will exhaust memory, phantoms of a batch are checked by
+        // the worker as they are read
+        const auto estimate = estimateMemory(m_data, settings);
+        if (!preview || !estimate.fitsInMemory())
+            emit simulationMemoryEstimated(QString::fromStdString(estimate.message()), estimate.fitsInMemory());
+        if (!estimate.fitsInMemory())
+            return;
+    }
+
+    emit dataProcessingStarted(ProgressWorkType::Simulating);
+    emit simulationRunning(true);
+    // the worker of the previous run leaves progress stopped, the timer and the worker both check it
+    m_progress.clearStopSimulation();
+    m_timerInterval = 500;
+    m_timerID = startTimer(m_timerInterval, Qt::CoarseTimer);
+    m_batchResult = nullptr;
+    m_pause.setPaused(false);
+    m_historiesPerSecond = 0;
+
+    // Planned histories, adaptive allocation adjusts the plan from the worker
+    auto planned = numberOfHistories(m_beams);
+    if (preview)
+        planned = std::min(planned, settings.previewHistories);
+    if (!sweep.empty())
+        planned = numberOfHistories(*m_beams.front()) * sweep.size();
+    if (isBatch)
+        planned *= batch.size();
+    m_runProgress.start(planned);
+
     if (m_lowenergyCorrection == 0) {
-        std::jthread t(worker<0>, m_deleteAirDose, m_threads, m_data, m_beams, &m_progress);
-        t.detach();
+        launchWorker<0>(m_worldItemType, settings, m_data, m_beams, &m_progress, &m_historiesPerSecond);
     } else if (m_lowenergyCorrection == 1) {
-        std::jthread t(worker<1>, m_deleteAirDose, m_threads, m_data, m_beams, &m_progress);
-        t.detach();
+        launchWorker<1>(m_worldItemType, settings, m_data, m_beams, &m_progress, &m_historiesPerSecond);
     } else {
-        std::jthread t(worker<2>, m_deleteAirDose, m_threads, m_data, m_beams, &m_progress);
-        t.detach();
+        launchWorker<2>(m_worldItemType, settings, m_data, m_beams, &m_progress, &m_historiesPerSecond);
     }
 }
 
+std::vector<int> calibrationCandidates()
+{
+    const int n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> candidates = { n / 4, n / 2, (3 * n) / 4, n, (3 * n) / 2, 2 * n };
+    std::erase_if(candidates, [](const auto c) { return c < 1; });
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+// Each trial is scaled with number of threads to keep runtime per trial about constant
+constexpr std::uint64_t calibrationHistoriesPerThread = 20000;
+
+std::uint64_t calibrationHistories()
+{
+    // including the warm up trial
+    const auto candidates = calibrationCandidates();
+    const auto threads = std::accumulate(candidates.cbegin(), candidates.cend(), candidates.front());
+    return calibrationHistoriesPerThread * static_cast<std::uint64_t>(threads);
+}
+
+template <typename VoxelGrid>
+int calibrationWorker(std::shared_ptr<DataContainer> data, Beam beam, dxmc::TransportProgress* progress, SimulationProgress* runProgress)
+{
+    using World = dxmc::World<VoxelGrid>;
+
+    World world;
+    auto& vgrid = world.template addItem<VoxelGrid>();
+    if (!setupVoxelGrid(vgrid, data, GridCrop(data->dimensions(), data->getMaterialArray())))
+        return 0;
+    world.build();
+
+    const auto candidates = calibrationCandidates();
+
+    auto trial = [&](int nthreads) -> double {
+        dxmc::Transport transport;
+        transport.setNumberOfThreads(nthreads);
+        return std::visit([&](auto& b) -> double {
+            const auto exposures = std::max(b.numberOfExposures(), std::uint64_t { 1 });
+            b.setNumberOfParticlesPerExposure(std::max((calibrationHistoriesPerThread * nthreads) / exposures, std::uint64_t { 1 }));
+            const auto histories = b.numberOfExposures() * b.numberOfParticlesPerExposure();
+            runProgress->beginTransport(histories);
+            const auto start = std::chrono::steady_clock::now();
+            transport(world, b, progress, true);
+            const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+            runProgress->endTransport();
+            return time.count() > 0 ? histories / time.count() : 0.0;
+        },
+            beam);
+    };
+
+    // warm up caches and thread pool before timing
+    trial(candidates.front());
+
+    int best = 0;
+    double best_rate = 0;
+    for (const auto n : candidates) {
+        if (!progress->continueSimulation())
+            return 0;
+        const auto rate = trial(n);
+        if (rate > best_rate) {
+            best_rate = rate;
+            best = n;
+        }
+    }
+    // a cancelled trial gives a too high rate
+    return progress->continueSimulation() ? best : 0;
+}
+
+template <int CORRECTION = 1>
+int calibrate(SimulationPipeline::WorldItemType type, std::shared_ptr<DataContainer> data, Beam beam, dxmc::TransportProgress* progress, SimulationProgress* runProgress)
+{
+    if (type == SimulationPipeline::WorldItemType::WoodcockVoxelGrid) {
+        const auto nmaterials = data->getMaterials().size();
+        if (nmaterials <= 8)
+            return calibrationWorker<WoodcockVoxelGrid<5, CORRECTION, 8>>(data, beam, progress, runProgress);
+        else if (nmaterials <= 32)
+            return calibrationWorker<WoodcockVoxelGrid<5, CORRECTION, 32>>(data, beam, progress, runProgress);
+        return calibrationWorker<WoodcockVoxelGrid<5, CORRECTION>>(data, beam, progress, runProgress);
+    }
+    return calibrationWorker<dxmc::AAVoxelGrid<5, CORRECTION, 255>>(data, beam, progress, runProgress);
+}
+
+template <int CORRECTION = 1>
+void launchCalibration(SimulationPipeline::WorldItemType type, std::shared_ptr<DataContainer> data, Beam beam, dxmc::TransportProgress* progress, SimulationProgress* runProgress, std::atomic<int>* result)
+{
+    std::jthread t([=]() {
+        *result = calibrate<CORRECTION>(type, data, beam, progress, runProgress);
+        progress->setStopSimulation();
+    });
+    t.detach();
+}
+
+// Calibrated values are only used when number of threads is automatic, a value set by the user is kept
+void SimulationPipeline::emitCalibratedNumberOfThreads()
+{
+    m_autoThreads = 0;
+    if (m_data) {
+        QSettings settings(QSettings::NativeFormat, QSettings::UserScope, "OpenDXMC", "app");
+        const auto key = calibrationSettingsKey(m_data, m_lowenergyCorrection, m_worldItemType);
+        if (settings.contains(key)) {
+            const auto nthreads_max = 2 * std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            m_autoThreads = std::clamp(settings.value(key).toInt(), 0, nthreads_max);
+        }
+    }
+    emit numberOfThreadsCalibrated(m_autoThreads);
+}
+
+void SimulationPipeline::calibrateNumberOfThreads()
+{
+    if (!testIfReadyForSimulation(true))
+        return;
+    emit dataProcessingStarted(ProgressWorkType::Simulating);
+    emit simulationRunning(true);
+    m_calibrating = true;
+    m_calibratedThreads = 0;
+    // image and settings may change while calibrating
+    m_calibrationKey = calibrationSettingsKey(m_data, m_lowenergyCorrection, m_worldItemType);
+    m_historiesPerSecond = 0;
+    m_pause.setPaused(false);
+    m_runProgress.start(calibrationHistories());
+    // a previous run leaves progress stopped
+    m_progress.clearStopSimulation();
+    m_timerInterval = 500;
+    m_timerID = startTimer(m_timerInterval, Qt::CoarseTimer);
+
+    const auto beam = *m_beams.front();
+    if (m_lowenergyCorrection == 0)
+        launchCalibration<0>(m_worldItemType, m_data, beam, &m_progress, &m_runProgress, &m_calibratedThreads);
+    else if (m_lowenergyCorrection == 1)
+        launchCalibration<1>(m_worldItemType, m_data, beam, &m_progress, &m_runProgress, &m_calibratedThreads);
+    else
+        launchCalibration<2>(m_worldItemType, m_data, beam, &m_progress, &m_runProgress, &m_calibratedThreads);
+}
+
+SimulationMemoryEstimate SimulationPipeline::memoryEstimate() const
+{
+    const WorkerSettings settings {
+        .cropAir = m_cropAir,
+        .woodcockTracking = m_worldItemType == WorldItemType::WoodcockVoxelGrid,
+        .doseScoringBlock = m_doseScoringBlock,
+        .organDoseOnly = m_organDoseOnly
+    };
+    return estimateMemory(m_data, settings);
+}
+
+void SimulationPipeline::emitMemoryEstimate()
+{
+    if (!m_data || !m_data->hasImage(DataContainer::ImageType::Density))
+        return;
+    const auto estimate = memoryEstimate();
+    emit simulationMemoryEstimated(QString::fromStdString(estimate.message()), estimate.fitsInMemory());
+}
+
 void SimulationPipeline::stopSimulation()
 {
     m_progress.setStopSimulation();
+    m_pause.setPaused(false);
+}
+
+void SimulationPipeline::setSimulationPaused(bool pause)
+{
+    m_pause.setPaused(pause);
 }
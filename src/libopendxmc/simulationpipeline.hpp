@@ -20,47 +20,153 @@ Copyright 2023 Erlend Andersen
 
 #include <basepipeline.hpp>
 #include <dxmc_specialization.hpp>
+#include <icrpphantomimportpipeline.hpp>
+#include <simulationmemoryestimate.hpp>
+#include <simulationprogress.hpp>
+#include <threadaffinity.hpp>
 #include "dxmc/transportprogress.hpp"
 
 
 #include <QString>
+#include <QStringList>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 
 
 class BeamActorContainer;
 class QTimerEvent;
 
+// Cooperative pause of the simulation worker. The worker calls waitWhilePaused between
+// transport passes and blocks until resumed or the simulation is stopped.
+class SimulationPauseControl {
+public:
+    void setPaused(bool on)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_paused = on;
+        }
+        m_cv.notify_all();
+    }
+    bool isPaused() const { return m_paused; }
+    void waitWhilePaused(const dxmc::TransportProgress& progress)
+    {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [&] { return !m_paused || !progress.continueSimulation(); });
+    }
+
+private:
+    std::atomic<bool> m_paused = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
 class SimulationPipeline : public BasePipeline {
     Q_OBJECT
 public:
+    enum class WorldItemType : int {
+        VoxelGrid,
+        WoodcockVoxelGrid
+    };
+    // Beam parameters of one variant in a parameter sweep, unset values are taken from the base beam
+    struct SweepVariant {
+        std::string name;
+        std::optional<double> tubeVoltage;
+        std::optional<double> aluminumFiltration;
+        std::optional<double> pitch;
+        std::optional<double> collimation;
+    };
     SimulationPipeline(QObject* parent = nullptr);
     ~SimulationPipeline();
     void updateImageData(std::shared_ptr<DataContainer>) override;
     void addBeamActor(std::shared_ptr<BeamActorContainer> actor);
     void removeBeamActor(std::shared_ptr<BeamActorContainer> actor);    
+    // Zero selects automatic, the calibrated number of threads for the image if any
     void setNumberOfThreads(int nthreads);
-    void setDeleteAirDose(bool on) { m_deleteAirDose = on; };
+    void setDeleteAirDose(bool on);
+    // Simulate only the bounding box of non air voxels, dose outside is zero
+    void setCropAir(bool on);
     void timerEvent(QTimerEvent*) override;
-    void setLowEnergyCorrectionLevel(int level) { m_lowenergyCorrection = level; }
+    void setLowEnergyCorrectionLevel(int level)
+    {
+        m_lowenergyCorrection = level;
+        emitCalibratedNumberOfThreads();
+    }
+    void setThreadPlacement(int placement);
+    void setMemoryPlacement(int placement);
+    void setDoseScoringBlockSize(int block);
+    void setWorldItemType(int type);
+    void setOrganDoseOnly(bool on);
+    void setAdaptiveBeamAllocation(bool on);
+    // Splitting and roulette towards organs of interest, only for Woodcock tracking
+    void setVarianceReduction(bool on);
+    void setOrgansOfInterest(QStringList organs);
     void startSimulation();
+    void startPreviewSimulation();
+    // Comma separated values for each parameter, all combinations are simulated with the first beam
+    void startSweep(QString tubeVoltage, QString aluminumFiltration, QString pitch, QString collimation);
+    // Simulates current beams on each phantom, scan ranges are scaled to the body extent of each phantom
+    void startBatchSimulation(std::vector<ICRPPhantom> phantoms, bool removeArms);
+    static std::vector<SweepVariant> sweepVariants(const QString& tubeVoltage, const QString& aluminumFiltration, const QString& pitch, const QString& collimation);
     void stopSimulation();
+    void setSimulationPaused(bool pause);
+    void calibrateNumberOfThreads();
 
 signals:
     void simulationReady(bool on);
     void simulationRunning(bool running);
     void simulationProgress(QString, int);
+    // Elapsed and remaining time in seconds, remaining is negative if not yet known
+    void simulationProgressStatus(double elapsed, double historiesPerSecond, double remaining);
+    void simulationThroughput(double historiesPerSecond);
+    // Calibrated number of threads for current image and settings, zero if not calibrated
+    void numberOfThreadsCalibrated(int nthreads);
+    // Air dose masking taken from image data, e.g dose loaded from file
+    void deleteAirDoseChanged(bool on);
+    void simulationMemoryEstimated(QString message, bool fitsInMemory);
+    void organNamesChanged(QStringList organs);
+    // Figure of merit of organs of interest, gain is zero if no analog reference exists
+    void simulationFigureOfMerit(double figureOfMerit, double gain);
 
 protected:
     bool testIfReadyForSimulation(bool test_image = true) const;
+    void runSimulation(bool preview, const std::vector<SweepVariant>& sweep = {}, const std::vector<ICRPPhantom>& batch = {}, bool batchRemoveArms = false);
     void finishingSimulation();
+    void emitCalibratedNumberOfThreads();
+    SimulationMemoryEstimate memoryEstimate() const;
+    void emitMemoryEstimate();
 
 
 private:
     std::shared_ptr<DataContainer> m_data = nullptr;
     std::vector<std::shared_ptr<Beam>> m_beams;
     int m_threads = 0;
+    int m_autoThreads = 0; // calibrated number of threads used if m_threads is zero
     int m_lowenergyCorrection = 1;
+    WorldItemType m_worldItemType = WorldItemType::VoxelGrid;
     bool m_deleteAirDose = true;
+    bool m_cropAir = true;
+    ThreadAffinity::ThreadPlacement m_threadPlacement = ThreadAffinity::ThreadPlacement::None;
+    ThreadAffinity::MemoryPlacement m_memoryPlacement = ThreadAffinity::MemoryPlacement::Default;
+    int m_doseScoringBlock = 1;
+    bool m_organDoseOnly = false;
+    bool m_adaptiveAllocation = false;
+    bool m_varianceReduction = false;
+    std::vector<std::string> m_organsOfInterest;
+    double m_analogFigureOfMerit = 0;
     int m_timerID = 0;
+    int m_timerInterval = 500;
+    double m_historiesPerSecond = 0; // written by worker before it stops progress
+    std::shared_ptr<DataContainer> m_batchResult = nullptr; // written by worker before it stops progress
+    std::atomic<int> m_calibratedThreads = 0; // written by calibration worker before it stops progress
+    bool m_calibrating = false;
+    QString m_calibrationKey;
     dxmc::TransportProgress m_progress;
+    SimulationProgress m_runProgress;
+    SimulationPauseControl m_pause;
 };
@@ -0,0 +1,130 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <simulationprogress.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+std::string SimulationProgress::Status::message() const
+{
+    char rate[32];
+    std::snprintf(rate, sizeof(rate), "%.3g", historiesPerSecond);
+    std::string msg = std::string(rate) + " histories/sec, elapsed " + formatDuration(elapsed);
+    if (remaining >= 0)
+        msg += ", about " + formatDuration(remaining) + " remaining";
+    return msg;
+}
+
+std::string SimulationProgress::formatDuration(double seconds)
+{
+    const auto s = static_cast<std::uint64_t>(std::max(std::round(seconds), 0.0));
+    const auto h = s / 3600;
+    const auto m = (s % 3600) / 60;
+    char buffer[32];
+    if (h > 0)
+        std::snprintf(buffer, sizeof(buffer), "%llu h %02llu min", static_cast<unsigned long long>(h), static_cast<unsigned long long>(m));
+    else if (m > 0)
+        std::snprintf(buffer, sizeof(buffer), "%llu min %02llu s", static_cast<unsigned long long>(m), static_cast<unsigned long long>(s % 60));
+    else
+        std::snprintf(buffer, sizeof(buffer), "%llu s", static_cast<unsigned long long>(s));
+    return buffer;
+}
+
+void SimulationProgress::start(std::uint64_t plannedHistories)
+{
+    m_planned = plannedHistories;
+    m_completed = 0;
+    m_current = 0;
+    m_start = Clock::now();
+    m_lastSample = m_start;
+    m_lastHistories = 0;
+    m_status = Status {};
+    m_status.plannedHistories = plannedHistories;
+}
+
+void SimulationProgress::addPlannedHistories(std::int64_t histories)
+{
+    if (histories < 0) {
+        const auto n = static_cast<std::uint64_t>(-histories);
+        auto planned = m_planned.load();
+        while (!m_planned.compare_exchange_weak(planned, planned > n ? planned - n : 0)) { }
+    } else {
+        m_planned += static_cast<std::uint64_t>(histories);
+    }
+}
+
+void SimulationProgress::beginTransport(std::uint64_t histories)
+{
+    m_current = histories;
+}
+
+void SimulationProgress::endTransport()
+{
+    m_completed += m_current.exchange(0);
+}
+
+SimulationProgress::Status SimulationProgress::sample(const dxmc::TransportProgress& progress)
+{
+    // Smoothing factor of the throughput average, weights about the last five samples
+    constexpr double alpha = 0.3;
+
+    const auto now = Clock::now();
+    const auto [n, total] = progress.progress();
+    const auto current = m_current.load();
+    const double callFraction = total > 0 ? std::clamp(static_cast<double>(n) / total, 0.0, 1.0) : 0.0;
+    // progress of dxmc is reset at start of each call, histories must not decrease between samples
+    const auto histories = std::max(m_completed.load() + static_cast<std::uint64_t>(current * callFraction), m_lastHistories);
+
+    Status status;
+    status.elapsed = std::chrono::duration<double>(now - m_start).count();
+    status.histories = histories;
+    status.plannedHistories = std::max(m_planned.load(), histories);
+    status.fraction = status.plannedHistories > 0 ? static_cast<double>(histories) / status.plannedHistories : 0.0;
+
+    const double dt = std::chrono::duration<double>(now - m_lastSample).count();
+    if (dt > 0 && histories > m_lastHistories) {
+        const double rate = (histories - m_lastHistories) / dt;
+        status.historiesPerSecond = m_status.historiesPerSecond > 0 ? alpha * rate + (1 - alpha) * m_status.historiesPerSecond : rate;
+    } else {
+        status.historiesPerSecond = m_status.historiesPerSecond;
+    }
+    if (status.historiesPerSecond > 0)
+        status.remaining = (status.plannedHistories - histories) / status.historiesPerSecond;
+
+    m_lastSample = now;
+    m_lastHistories = histories;
+    m_status = status;
+    return status;
+}
+
+void SimulationProgress::restartSampling()
+{
+    m_lastSample = Clock::now();
+}
+
+int SimulationProgress::pollInterval() const
+{
+    constexpr int minInterval = 250;
+    constexpr int maxInterval = 5000;
+    if (m_status.remaining < 0)
+        return 500;
+    const auto total = (m_status.elapsed + m_status.remaining) * 1000 / 50;
+    return std::clamp(static_cast<int>(total), minInterval, maxInterval);
+}
@@ -0,0 +1,70 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include "dxmc/transportprogress.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Progress of a simulation counted in histories, shared by all transport calls of a run.
+// The worker reports histories of each transport call, the running call is interpolated from
+// dxmc::TransportProgress. Sampling gives throughput, elapsed time and a smoothed estimate
+// of remaining time. Does not depend on Qt so it can be polled from any front end.
+class SimulationProgress {
+public:
+    struct Status {
+        double fraction = 0;
+        double elapsed = 0; // seconds
+        double historiesPerSecond = 0; // exponential moving average
+        double remaining = -1; // seconds, negative if unknown
+        std::uint64_t histories = 0;
+        std::uint64_t plannedHistories = 0;
+
+        std::string message() const;
+    };
+
+    // Called before the worker starts, i.e not concurrently with the worker
+    void start(std::uint64_t plannedHistories);
+    // Worker side, adjusts plan when histories are reallocated or added (i.e pilot runs)
+    void addPlannedHistories(std::int64_t histories);
+    void beginTransport(std::uint64_t histories);
+    void endTransport();
+
+    // Observer side, must be called from one thread only
+    Status sample(const dxmc::TransportProgress& progress);
+    // Discards throughput since last sample, i.e after a pause
+    void restartSampling();
+    // Suggested polling interval in milliseconds, about 50 updates over a run
+    int pollInterval() const;
+
+    static std::string formatDuration(double seconds);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    std::atomic<std::uint64_t> m_planned = 0;
+    std::atomic<std::uint64_t> m_completed = 0;
+    std::atomic<std::uint64_t> m_current = 0;
+    Clock::time_point m_start;
+    Clock::time_point m_lastSample;
+    std::uint64_t m_lastHistories = 0;
+    Status m_status;
+};
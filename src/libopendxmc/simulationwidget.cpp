@@ -16,6 +16,7 @@ along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
 Copyright 2023 Erlend Andersen
 */
 
+#include <simulationprogress.hpp>
 #include <simulationwidget.hpp>
 
 #include <QCheckBox>
@@ -23,8 +24,12 @@ Copyright 2023 Erlend Andersen
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QSignalBlocker>
 #include <QSpinBox>
 
+#include <algorithm>
 #include <thread>
 #include <utility>
 
@@ -54,17 +59,52 @@ SimulationWidget::SimulationWidget(QWidget* parent)
     this->setLayout(layout);
 
     const auto n_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
-    auto threads_txt = tr("Select number of threads for simulations, setting this to 0 uses ");
+    auto threads_txt = tr("Select number of threads for simulations. Auto uses the calibrated number of threads for this host and grid size if available, otherwise ");
     threads_txt += QString::number(n_threads) + tr(" threads.");
     // threads widget
     auto [threads_spin, threads_box] = createWidget<QSpinBox>(tr("Number of threads"), threads_txt, this);
     threads_spin->setRange(0, n_threads * 2);
     threads_spin->setSuffix(tr(" threads"));
+    threads_spin->setSpecialValueText(tr("Auto"));
     threads_spin->setValue(0);
     connect(threads_spin, &QSpinBox::valueChanged, this, &SimulationWidget::numberOfThreadsChanged);
+    connect(threads_spin, &QSpinBox::valueChanged, this, &SimulationWidget::updateThreadsLabel);
+    m_threads_spin = threads_spin;
+    m_threads_label = new QLabel(threads_box);
+    threads_box->layout()->addWidget(m_threads_label);
+    m_calibrate_threads_button = new QPushButton(tr("Calibrate"), threads_box);
+    m_calibrate_threads_button->setToolTip(tr("Run a short simulation with different number of threads and select the fastest. The result is stored for this host and grid size and used when number of threads is Auto."));
+    m_calibrate_threads_button->setEnabled(false);
+    threads_box->layout()->addWidget(m_calibrate_threads_button);
+    connect(m_calibrate_threads_button, &QPushButton::clicked, this, [this]() {
+        // the user asks for the calibrated value
+        m_threads_spin->setValue(0);
+        emit requestCalibrateNumberOfThreads();
+    });
+    updateThreadsLabel();
     layout->addWidget(threads_box);
     m_items.push_back(threads_box);
 
+    auto placement_txt = tr("Bind simulation threads to CPUs. Compact fills one NUMA node before the next, scatter spreads threads evenly across nodes.");
+    auto [placement_select, placement_box] = createWidget<QComboBox>(tr("Thread placement"), placement_txt, this);
+    placement_select->addItem(tr("None"));
+    placement_select->addItem(tr("Compact"));
+    placement_select->addItem(tr("Scatter"));
+    placement_select->setCurrentIndex(0);
+    connect(placement_select, &QComboBox::currentIndexChanged, this, &SimulationWidget::threadPlacementChanged);
+    layout->addWidget(placement_box);
+    m_items.push_back(placement_box);
+
+    auto memory_txt = tr("Placement of voxel grid and dose tallies. First touch allocates memory on the nodes of the simulation threads, interleaved spreads pages across nodes.");
+    auto [memory_select, memory_box] = createWidget<QComboBox>(tr("Memory placement"), memory_txt, this);
+    memory_select->addItem(tr("Default"));
+    memory_select->addItem(tr("First touch"));
+    memory_select->addItem(tr("Interleaved"));
+    memory_select->setCurrentIndex(0);
+    connect(memory_select, &QComboBox::currentIndexChanged, this, &SimulationWidget::memoryPlacementChanged);
+    layout->addWidget(memory_box);
+    m_items.push_back(memory_box);
+
     // auto lec_txt = tr("Select bound electron correction method: None treats all electrons as free. Livermore applies atomic form factor and scatterfactor corrections to coherent and incoherent scattering. Impulse Approximation uses Harthree-Fock approximation to sample electron momentum for atomic shells for coherent scattering, in addition fluro photons are emitted for photoelectric effect.");
     auto lec_txt = tr("Select bound electron correction method");
     auto [lec_select, lec_box] = createWidget<QComboBox>(tr("Bound electron correction method"), lec_txt, this);
@@ -76,7 +116,28 @@ SimulationWidget::SimulationWidget(QWidget* parent)
     layout->addWidget(lec_box);
     m_items.push_back(lec_box);
 
-    auto air_txt = tr("Remove dose to air for easier visualization of dose. Photons are still transported through air media.");
+    auto tracking_txt = tr("Select photon tracking method: Voxel tracking steps through every voxel along the photon path. Woodcock delta tracking steps through blocks of voxels using a majorant attenuation coefficient, which is faster for segmented images with large homogeneous regions.");
+    auto [tracking_select, tracking_box] = createWidget<QComboBox>(tr("Photon tracking method"), tracking_txt, this);
+    tracking_select->addItem(tr("Voxel tracking"));
+    tracking_select->addItem(tr("Woodcock delta tracking"));
+    tracking_select->setCurrentIndex(0);
+    connect(tracking_select, &QComboBox::currentIndexChanged, this, &SimulationWidget::worldItemTypeChanged);
+    layout->addWidget(tracking_box);
+    m_items.push_back(tracking_box);
+
+    auto block_txt = tr("Score dose on a coarser grid of voxel blocks, requires Woodcock delta tracking. Transport still uses the full resolution geometry, but noise per dose bin is reduced. Dose images are stored with the block resolution, which reduces memory use and file size. Organ dose only simulations and parameter sweeps always score dose per voxel.");
+    auto [block_select, block_box] = createWidget<QComboBox>(tr("Dose scoring resolution"), block_txt, this);
+    block_select->addItem(tr("Voxel"));
+    block_select->addItem(tr("2x2x2 voxels"));
+    block_select->addItem(tr("4x4x4 voxels"));
+    block_select->setCurrentIndex(0);
+    connect(block_select, &QComboBox::currentIndexChanged, [this](int idx) {
+        emit this->doseScoringBlockSizeChanged(1 << idx);
+    });
+    layout->addWidget(block_box);
+    m_items.push_back(block_box);
+
+    auto air_txt = tr("Hide dose to air for easier visualization of dose. Photons are still transported through air media and dose to air is shown again when unchecked. Dose is zero outside the simulated region if air surrounding the body is not simulated.");
     auto air_box = new QGroupBox(tr("Ignore air dose"), parent);
     air_box->setCheckable(true);
     auto air_layout = new QHBoxLayout;
@@ -85,26 +146,149 @@ SimulationWidget::SimulationWidget(QWidget* parent)
     air_label->setWordWrap(true);
     air_layout->addWidget(air_label);
     connect(air_box, &QGroupBox::toggled, this, &SimulationWidget::ignoreAirChanged);
+    m_air_box = air_box;
     layout->addWidget(air_box);
     m_items.push_back(air_box);
 
+    auto crop_txt = tr("Simulate only the bounding box of the body and skip surrounding air, which is faster and uses less memory. Dose outside the bounding box is zero.");
+    auto crop_box = new QGroupBox(tr("Skip air surrounding the body"), parent);
+    crop_box->setCheckable(true);
+    crop_box->setChecked(true);
+    auto crop_layout = new QHBoxLayout;
+    crop_box->setLayout(crop_layout);
+    auto crop_label = new QLabel(crop_txt, crop_box);
+    crop_label->setWordWrap(true);
+    crop_layout->addWidget(crop_label);
+    connect(crop_box, &QGroupBox::toggled, this, &SimulationWidget::cropAirChanged);
+    layout->addWidget(crop_box);
+    m_items.push_back(crop_box);
+
+    auto organ_txt = tr("Tally dose per organ only. Voxel dose arrays are not stored, which reduces memory use substantially. Requires an organ segmented phantom.");
+    auto organ_box = new QGroupBox(tr("Organ dose only"), this);
+    organ_box->setCheckable(true);
+    organ_box->setChecked(false);
+    auto organ_layout = new QHBoxLayout;
+    organ_box->setLayout(organ_layout);
+    auto organ_label = new QLabel(organ_txt, organ_box);
+    organ_label->setWordWrap(true);
+    organ_layout->addWidget(organ_label);
+    connect(organ_box, &QGroupBox::toggled, this, &SimulationWidget::organDoseOnlyChanged);
+    layout->addWidget(organ_box);
+    m_items.push_back(organ_box);
+
+    auto adaptive_txt = tr("Run a short pilot simulation of each beam and redistribute histories between beams to minimize dose uncertainty for the same simulation time. Only applies to simulations with more than one beam.");
+    auto adaptive_box = new QGroupBox(tr("Adaptive particle allocation"), this);
+    adaptive_box->setCheckable(true);
+    adaptive_box->setChecked(false);
+    auto adaptive_layout = new QHBoxLayout;
+    adaptive_box->setLayout(adaptive_layout);
+    auto adaptive_label = new QLabel(adaptive_txt, adaptive_box);
+    adaptive_label->setWordWrap(true);
+    adaptive_layout->addWidget(adaptive_label);
+    connect(adaptive_box, &QGroupBox::toggled, this, &SimulationWidget::adaptiveBeamAllocationChanged);
+    layout->addWidget(adaptive_box);
+    m_items.push_back(adaptive_box);
+
+    auto vr_txt = tr("Split photons moving towards the selected organs and play Russian roulette with photons moving away from them. Reduces uncertainty of peripheral organ doses for the same simulation time, but increases uncertainty elsewhere. Only applies to Woodcock delta tracking. Figure of merit is reported for the selected organs.");
+    auto vr_box = new QGroupBox(tr("Variance reduction"), this);
+    vr_box->setCheckable(true);
+    vr_box->setChecked(false);
+    auto vr_layout = new QVBoxLayout;
+    vr_box->setLayout(vr_layout);
+    auto vr_label = new QLabel(vr_txt, vr_box);
+    vr_label->setWordWrap(true);
+    vr_layout->addWidget(vr_label);
+    m_organs_of_interest_list = new QListWidget(vr_box);
+    vr_layout->addWidget(m_organs_of_interest_list);
+    connect(m_organs_of_interest_list, &QListWidget::itemChanged, [this](QListWidgetItem*) {
+        QStringList organs;
+        for (int i = 0; i < m_organs_of_interest_list->count(); ++i) {
+            auto item = m_organs_of_interest_list->item(i);
+            if (item->checkState() == Qt::Checked)
+                organs.append(item->text());
+        }
+        emit this->organsOfInterestChanged(organs);
+    });
+    connect(vr_box, &QGroupBox::toggled, this, &SimulationWidget::varianceReductionChanged);
+    layout->addWidget(vr_box);
+    m_items.push_back(vr_box);
+
+    auto sweep_box = new QGroupBox(tr("Parameter sweep"), this);
+    auto sweep_layout = new QVBoxLayout;
+    sweep_box->setLayout(sweep_layout);
+    auto sweep_label = new QLabel(tr("Simulate all combinations of the comma separated values below with the first beam, reusing the same world. Empty fields keep the beam value. Organ doses for each variant are shown in the dose table."), sweep_box);
+    sweep_label->setWordWrap(true);
+    sweep_layout->addWidget(sweep_label);
+    auto sweep_edit = [=](const QString& name, const QString& placeholder) {
+        auto row = new QHBoxLayout;
+        row->addWidget(new QLabel(name, sweep_box));
+        auto edit = new QLineEdit(sweep_box);
+        edit->setPlaceholderText(placeholder);
+        row->addWidget(edit);
+        sweep_layout->addLayout(row);
+        return edit;
+    };
+    auto sweep_kv = sweep_edit(tr("Tube voltage [kV]"), tr("i.e 80, 100, 120"));
+    auto sweep_al = sweep_edit(tr("Al filtration [mm]"), tr("i.e 3, 6, 9"));
+    auto sweep_pitch = sweep_edit(tr("Pitch"), tr("i.e 0.8, 1.0, 1.5"));
+    auto sweep_coll = sweep_edit(tr("Collimation [cm]"), tr("i.e 2, 4"));
+    m_sweep_button = new QPushButton(tr("Run sweep"), sweep_box);
+    m_sweep_button->setEnabled(false);
+    sweep_layout->addWidget(m_sweep_button);
+    connect(m_sweep_button, &QPushButton::clicked, [=, this]() {
+        emit this->requestStartSweep(sweep_kv->text(), sweep_al->text(), sweep_pitch->text(), sweep_coll->text());
+    });
+    layout->addWidget(sweep_box);
+    m_items.push_back(sweep_box);
+
     auto start_stop_box = new QGroupBox(tr("Start simulation"), this);
     auto start_stop_layout = new QHBoxLayout;
     start_stop_box->setLayout(start_stop_layout);
     m_start_simulation_button = new QPushButton(tr("Start"), start_stop_box);
+    m_preview_simulation_button = new QPushButton(tr("Preview"), start_stop_box);
+    m_preview_simulation_button->setToolTip(tr("Run a quick simulation on a downsampled grid with a small number of histories. The result is marked as preview."));
+    m_pause_simulation_button = new QPushButton(tr("Pause"), start_stop_box);
+    m_pause_simulation_button->setCheckable(true);
+    m_pause_simulation_button->setToolTip(tr("Pause a running simulation to free the CPUs, accumulated histories are kept. The simulation pauses after the current transport pass."));
     m_stop_simulation_button = new QPushButton(tr("Cancel"), start_stop_box);
     start_stop_layout->addWidget(m_start_simulation_button);
+    start_stop_layout->addWidget(m_preview_simulation_button);
+    start_stop_layout->addWidget(m_pause_simulation_button);
     start_stop_layout->addWidget(m_stop_simulation_button);
     connect(m_start_simulation_button, &QPushButton::clicked, this, &SimulationWidget::requestStartSimulation);
+    connect(m_preview_simulation_button, &QPushButton::clicked, this, &SimulationWidget::requestStartPreviewSimulation);
+    connect(m_pause_simulation_button, &QPushButton::toggled, [this](bool checked) {
+        m_pause_simulation_button->setText(checked ? tr("Resume") : tr("Pause"));
+        emit this->requestPauseSimulation(checked);
+    });
     connect(m_stop_simulation_button, &QPushButton::clicked, this, &SimulationWidget::requestStopSimulation);
     m_start_simulation_button->setEnabled(false);
+    m_preview_simulation_button->setEnabled(false);
     m_stop_simulation_button->setEnabled(false);
+    m_pause_simulation_button->setEnabled(false);
     layout->addWidget(start_stop_box);
 
     m_progress_bar = new QProgressBar(this);
     layout->addWidget(m_progress_bar);
     m_progress_bar->hide();
 
+    m_progress_status_label = new QLabel(this);
+    layout->addWidget(m_progress_status_label);
+    m_progress_status_label->hide();
+
+    m_throughput_label = new QLabel(this);
+    layout->addWidget(m_throughput_label);
+    m_throughput_label->hide();
+
+    m_figure_of_merit_label = new QLabel(this);
+    layout->addWidget(m_figure_of_merit_label);
+    m_figure_of_merit_label->hide();
+
+    m_memory_label = new QLabel(this);
+    m_memory_label->setWordWrap(true);
+    layout->addWidget(m_memory_label);
+    m_memory_label->hide();
+
     layout->addStretch(100);
 }
 
@@ -112,6 +296,9 @@ void SimulationWidget::setSimulationReady(bool on)
 {
     m_simulation_ready = on;
     m_start_simulation_button->setDisabled(!m_simulation_ready);
+    m_preview_simulation_button->setDisabled(!m_simulation_ready);
+    m_sweep_button->setDisabled(!m_simulation_ready);
+    m_calibrate_threads_button->setDisabled(!m_simulation_ready);
 }
 
 void SimulationWidget::setSimulationRunning(bool on)
@@ -119,8 +306,18 @@ void SimulationWidget::setSimulationRunning(bool on)
     for (auto& wid : m_items)
         wid->setDisabled(on);
     m_start_simulation_button->setDisabled(on);
+    m_preview_simulation_button->setDisabled(on);
+    m_sweep_button->setDisabled(on || !m_simulation_ready);
     m_stop_simulation_button->setDisabled(!on);
+    m_pause_simulation_button->setDisabled(!on);
+    if (!on) {
+        const QSignalBlocker blocker(m_pause_simulation_button);
+        m_pause_simulation_button->setChecked(false);
+        m_pause_simulation_button->setText(tr("Pause"));
+    }
+    m_calibrate_threads_button->setDisabled(on || !m_simulation_ready);
     m_progress_bar->setVisible(on);
+    m_progress_status_label->setVisible(false);
 }
 
 void SimulationWidget::updateSimulationProgress(QString message, int percent)
@@ -131,4 +328,74 @@ void SimulationWidget::updateSimulationProgress(QString message, int percent)
     }
     p->setValue(percent);
     p->setFormat(message);
-}
\ No newline at end of file
+}
+
+void SimulationWidget::updateSimulationProgressStatus(double elapsed, double historiesPerSecond, double remaining)
+{
+    SimulationProgress::Status status;
+    status.elapsed = elapsed;
+    status.historiesPerSecond = historiesPerSecond;
+    status.remaining = remaining;
+    m_progress_status_label->setText(QString::fromStdString(status.message()));
+    m_progress_status_label->setVisible(m_progress_bar->isVisible());
+}
+
+void SimulationWidget::setSimulationThroughput(double historiesPerSecond)
+{
+    auto txt = tr("Last simulation: ") + QString::number(historiesPerSecond, 'g', 4) + tr(" histories/sec");
+    m_throughput_label->setText(txt);
+    m_throughput_label->show();
+}
+
+void SimulationWidget::setOrganNames(QStringList organs)
+{
+    const QSignalBlocker blocker(m_organs_of_interest_list);
+    m_organs_of_interest_list->clear();
+    for (const auto& o : organs) {
+        auto item = new QListWidgetItem(o, m_organs_of_interest_list);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Unchecked);
+    }
+    emit organsOfInterestChanged(QStringList {});
+}
+
+void SimulationWidget::setSimulationFigureOfMerit(double figureOfMerit, double gain)
+{
+    auto txt = tr("Figure of merit of selected organs: ") + QString::number(figureOfMerit, 'g', 4);
+    if (gain > 0)
+        txt += tr(", gain ") + QString::number(gain, 'g', 3) + tr(" compared to last simulation without variance reduction");
+    m_figure_of_merit_label->setText(txt);
+    m_figure_of_merit_label->show();
+}
+
+void SimulationWidget::setCalibratedNumberOfThreads(int nthreads)
+{
+    m_calibrated_threads = nthreads;
+    updateThreadsLabel();
+}
+
+void SimulationWidget::updateThreadsLabel()
+{
+    const auto n_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (m_threads_spin->value() == 0 && m_calibrated_threads > 0)
+        m_threads_label->setText(tr("Using calibrated ") + QString::number(m_calibrated_threads) + tr(" threads"));
+    else if (m_threads_spin->value() == 0)
+        m_threads_label->setText(tr("Using ") + QString::number(n_threads) + tr(" threads"));
+    else if (m_calibrated_threads > 0)
+        m_threads_label->setText(tr("Calibrated ") + QString::number(m_calibrated_threads) + tr(" threads, select Auto to use"));
+    else
+        m_threads_label->clear();
+}
+
+void SimulationWidget::setIgnoreAir(bool on)
+{
+    const QSignalBlocker blocker(m_air_box);
+    m_air_box->setChecked(on);
+}
+
+void SimulationWidget::setSimulationMemoryEstimate(QString message, bool fitsInMemory)
+{
+    m_memory_label->setText(message);
+    m_memory_label->setStyleSheet(fitsInMemory ? QString() : QString("QLabel { color : red; }"));
+    m_memory_label->show();
+}
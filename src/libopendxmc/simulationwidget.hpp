@@ -18,12 +18,18 @@ Copyright 2023 Erlend Andersen
 
 #pragma once
 
+#include <QGroupBox>
+#include <QLabel>
 #include <QPushButton>
 #include <QWidget>
 #include <QProgressBar>
+#include <QSpinBox>
+#include <QStringList>
 
 #include <vector>
 
+class QListWidget;
+
 class SimulationWidget : public QWidget {
     Q_OBJECT
 public:
@@ -31,17 +37,54 @@ public:
     void setSimulationReady(bool on);
     void setSimulationRunning(bool on);
     void updateSimulationProgress(QString, int);
+    void updateSimulationProgressStatus(double elapsed, double historiesPerSecond, double remaining);
+    void setSimulationThroughput(double historiesPerSecond);
+    void setCalibratedNumberOfThreads(int nthreads);
+    void setSimulationMemoryEstimate(QString message, bool fitsInMemory);
+    void setOrganNames(QStringList organs);
+    void setSimulationFigureOfMerit(double figureOfMerit, double gain);
+    // Follows the air masking of loaded dose, does not emit ignoreAirChanged
+    void setIgnoreAir(bool on);
 signals:
     void numberOfThreadsChanged(int);
+    void threadPlacementChanged(int);
+    void memoryPlacementChanged(int);
     void lowEnergyCorrectionMethodChanged(int);
+    void worldItemTypeChanged(int);
+    void doseScoringBlockSizeChanged(int);
     void requestStartSimulation();
+    void requestStartPreviewSimulation();
+    void requestStartSweep(QString tubeVoltage, QString aluminumFiltration, QString pitch, QString collimation);
     void requestStopSimulation();
+    void requestPauseSimulation(bool);
+    void requestCalibrateNumberOfThreads();
     void ignoreAirChanged(bool);
+    void cropAirChanged(bool);
+    void organDoseOnlyChanged(bool);
+    void adaptiveBeamAllocationChanged(bool);
+    void varianceReductionChanged(bool);
+    void organsOfInterestChanged(QStringList);
+
+protected:
+    void updateThreadsLabel();
 
 private:
     bool m_simulation_ready = false;
     QPushButton* m_start_simulation_button = nullptr;
+    QPushButton* m_preview_simulation_button = nullptr;
+    QPushButton* m_sweep_button = nullptr;
     QPushButton* m_stop_simulation_button = nullptr;
+    QPushButton* m_pause_simulation_button = nullptr;
+    QPushButton* m_calibrate_threads_button = nullptr;
+    QSpinBox* m_threads_spin = nullptr;
+    QLabel* m_threads_label = nullptr;
+    int m_calibrated_threads = 0;
+    QGroupBox* m_air_box = nullptr;
+    QListWidget* m_organs_of_interest_list = nullptr;
     std::vector<QWidget*> m_items;
     QProgressBar* m_progress_bar = nullptr;
+    QLabel* m_progress_status_label = nullptr;
+    QLabel* m_throughput_label = nullptr;
+    QLabel* m_figure_of_merit_label = nullptr;
+    QLabel* m_memory_label = nullptr;
 };
\ No newline at end of file
@@ -43,6 +43,8 @@ Copyright 2023 Erlend Andersen
 #include <vtkTextProperty.h>
 #include <vtkWindowToImageFilter.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 constexpr std::array<double, 3> TEXT_COLOR = { 0.6, 0.5, 0.1 };
@@ -254,7 +256,17 @@ void SliceRenderWidget::setupSlicePipeline(int orientation, bool lowerLeftText,
     if (colorbar) {
         auto scalarColorBar = vtkSmartPointer<vtkScalarBarActor>::New();
         scalarColorBar->SetNumberOfLabels(2);
-        scalarColorBar->SetLookupTable(m_lut);
+        // colorbar is labeled in display units, table values are copied from m_lut on render
+        m_colorbarLut = vtkSmartPointer<vtkLookupTable>::New();
+        scalarColorBar->SetLookupTable(m_colorbarLut);
+        // window and level are changed by the interactor style and other widgets which renders
+        // the window directly, hence the colorbar is updated at start of every render
+        auto colorbarCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+        colorbarCallback->SetClientData(this);
+        colorbarCallback->SetCallback([](vtkObject*, unsigned long, void* clientData, void*) {
+            static_cast<SliceRenderWidget*>(clientData)->updateColorbar();
+        });
+        renWin->AddObserver(vtkCommand::StartEvent, colorbarCallback);
         scalarColorBar->SetUnconstrainedFontSize(true);
         scalarColorBar->SetBarRatio(0.1);
         auto txtStyle = vtkSmartPointer<vtkTextProperty>::New();
@@ -370,6 +382,11 @@ void SliceRenderWidget::setUseCTDataBackground(bool on)
     }
 }
 
+bool divergingLUT(DataContainer::ImageType type)
+{
+    return type == DataContainer::ImageType::DoseDifference || type == DataContainer::ImageType::DoseRatio || type == DataContainer::ImageType::DoseZScore;
+}
+
 void SliceRenderWidget::switchLUTtable(DataContainer::ImageType type)
 {
     auto prop = m_imageSliceFront->GetProperty();
@@ -412,6 +429,16 @@ void SliceRenderWidget::switchLUTtable(DataContainer::ImageType type)
                 const auto ii = i * 3;
                 m_lut->SetTableValue(i, map[ii], map[ii + 1], map[ii + 2], 1.0);
             }
+        } else if (divergingLUT(type)) {
+            // blue to white to red, white is no difference
+            const auto n = m_lut->GetNumberOfTableValues();
+            for (int i = 0; i < n; ++i) {
+                const auto t = 2.0 * i / (n - 1) - 1.0;
+                if (t < 0)
+                    m_lut->SetTableValue(i, 1 + t, 1 + t, 1, 1.0);
+                else
+                    m_lut->SetTableValue(i, 1, 1 - t, 1 - t, 1.0);
+            }
         }
 
         if (lut_windowing.contains(type)) {
@@ -423,6 +450,11 @@ void SliceRenderWidget::switchLUTtable(DataContainer::ImageType type)
             vtkimage->GetScalarRange(range.data());
             auto wl = (range[0] + range[1]) / 2;
             auto ww = range[1] - range[0];
+            if (divergingLUT(type)) {
+                // centered on no difference
+                wl = type == DataContainer::ImageType::DoseRatio ? 1.0 : 0.0;
+                ww = 2 * std::max(std::abs(range[0] - wl), std::abs(range[1] - wl));
+            }
             prop->SetColorLevel(wl);
             prop->SetColorWindow(ww);
         }
@@ -437,6 +469,7 @@ void SliceRenderWidget::showData(DataContainer::ImageType type)
         return;
     if (m_data->hasImage(type)) {
         auto vtkimage = m_data->vtkImage(type);
+        m_displayScale = m_data->displayScale(type);
         switchLUTtable(type);
 
         // setup background
@@ -498,6 +531,19 @@ void SliceRenderWidget::Render(bool reset_camera)
     openGLWidget->renderWindow()->Render();
 }
 
+void SliceRenderWidget::updateColorbar()
+{
+    if (!m_colorbarLut)
+        return;
+    m_colorbarLut->DeepCopy(m_lut);
+    auto prop = m_imageSliceFront->GetProperty();
+    if (!prop->GetUseLookupTableScalarRange()) {
+        const auto wl = prop->GetColorLevel();
+        const auto ww = prop->GetColorWindow();
+        m_colorbarLut->SetTableRange((wl - ww / 2) * m_displayScale, (wl + ww / 2) * m_displayScale);
+    }
+}
+
 void SliceRenderWidget::setNewImageData(vtkSmartPointer<vtkImageData> data, bool rezoom_camera)
 {
     if (data) {
@@ -28,6 +28,7 @@ Copyright 2023 Erlend Andersen
 #include <vtkImageGaussianSmooth.h>
 #include <vtkImageSincInterpolator.h>
 #include <vtkImageStack.h>
+#include <vtkLookupTable.h>
 #include <vtkRenderer.h>
 #include <vtkSmartPointer.h>
 #include <vtkTextActor.h>
@@ -55,6 +56,8 @@ public:
     void registerStyleCallback(vtkSmartPointer<vtkCallbackCommand> cmd, const std::vector<vtkCommand::EventIds>& events);
     void showData(DataContainer::ImageType type);
     void Render(bool reset_camera = false);
+    // Factor from stored image values to displayed units
+    double displayScale() const { return m_displayScale; }
 
     void addActor(vtkSmartPointer<vtkActor> actor);
     void removeActor(vtkSmartPointer<vtkActor> actor);
@@ -70,6 +73,7 @@ protected:
     void resizeEvent(QResizeEvent* event) override;
     void updateTextPositions(bool render = false);
     void resetCamera();
+    void updateColorbar();
 
 private:
     std::shared_ptr<DataContainer> m_data = nullptr;
@@ -83,6 +87,8 @@ private:
     vtkSmartPointer<vtkTextActor> m_unitText = nullptr;
     vtkSmartPointer<vtkTextActor> m_windowText = nullptr;
     vtkSmartPointer<vtkWindowLevelLookupTable> m_lut = nullptr;
+    vtkSmartPointer<vtkLookupTable> m_colorbarLut = nullptr;
+    double m_displayScale = 1;
     std::map<DataContainer::ImageType, std::pair<double, double>> lut_windowing;
     DataContainer::ImageType lut_current_type = DataContainer::ImageType::CT;
     bool m_useCTBackground = false;
@@ -0,0 +1,224 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <threadaffinity.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::vector<int> ThreadAffinity::parseCpuList(const std::string& list)
+{
+    // Linux cpulist format, i.e "0-7,16-23"
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty())
+            continue;
+        try {
+            const auto dash = range.find('-');
+            if (dash == std::string::npos) {
+                cpus.push_back(std::stoi(range));
+            } else {
+                const auto start = std::stoi(range.substr(0, dash));
+                const auto stop = std::stoi(range.substr(dash + 1));
+                for (int i = start; i <= stop; ++i)
+                    cpus.push_back(i);
+            }
+        } catch (...) {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+std::vector<ThreadAffinity::NumaNode> ThreadAffinity::numaNodes()
+{
+    std::vector<NumaNode> nodes;
+#ifdef __linux__
+    const std::filesystem::path nodedir("/sys/devices/system/node");
+    auto readList = [](const std::filesystem::path& path) {
+        std::ifstream f(path);
+        std::string list;
+        std::getline(f, list);
+        return parseCpuList(list);
+    };
+    // online node ids need not be contiguous, i.e after hot removal or on some multi socket hosts
+    auto ids = readList(nodedir / "online");
+    if (ids.empty()) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(nodedir, ec)) {
+            const auto name = entry.path().filename().string();
+            if (name.size() > 4 && name.starts_with("node") && std::all_of(name.cbegin() + 4, name.cend(), [](const char c) { return c >= '0' && c <= '9'; }))
+                ids.push_back(std::stoi(name.substr(4)));
+        }
+        std::sort(ids.begin(), ids.end());
+    }
+    for (const auto id : ids) {
+        auto cpus = readList(nodedir / ("node" + std::to_string(id)) / "cpulist");
+        // skipping memory only nodes
+        if (!cpus.empty())
+            nodes.push_back({ .id = id, .cpus = std::move(cpus) });
+    }
+#endif
+    if (nodes.empty()) {
+        const auto n_cpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        std::vector<int> cpus(n_cpus);
+        std::iota(cpus.begin(), cpus.end(), 0);
+        nodes.push_back({ .id = 0, .cpus = std::move(cpus) });
+    }
+    return nodes;
+}
+
+static std::vector<int> processCpus()
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+        std::vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set))
+                cpus.push_back(c);
+        if (!cpus.empty())
+            return cpus;
+    }
+#endif
+    std::vector<int> cpus;
+    for (const auto& n : ThreadAffinity::numaNodes())
+        cpus.insert(cpus.end(), n.cpus.cbegin(), n.cpus.cend());
+    return cpus;
+}
+
+// Read when the library is loaded, before any thread is bound
+static const std::vector<int> startupCpus = processCpus();
+
+const std::vector<int>& ThreadAffinity::allowedCpus()
+{
+    return startupCpus;
+}
+
+std::vector<int> ThreadAffinity::selectCpus(ThreadPlacement placement, int nthreads)
+{
+    // nodes restricted to allowed CPUs, nodes without any are skipped
+    const auto& allowed = allowedCpus();
+    std::vector<NumaNode> nodes;
+    for (auto node : numaNodes()) {
+        std::erase_if(node.cpus, [&](const auto c) { return std::find(allowed.cbegin(), allowed.cend(), c) == allowed.cend(); });
+        if (!node.cpus.empty())
+            nodes.push_back(std::move(node));
+    }
+    if (nodes.empty())
+        nodes.push_back({ .id = 0, .cpus = allowed });
+    std::vector<int> all;
+    for (const auto& n : nodes)
+        all.insert(all.end(), n.cpus.cbegin(), n.cpus.cend());
+
+    if (placement == ThreadPlacement::None || nthreads <= 0 || nthreads >= static_cast<int>(all.size()))
+        return all;
+
+    std::vector<int> cpus;
+    cpus.reserve(nthreads);
+    if (placement == ThreadPlacement::Compact) {
+        cpus.assign(all.cbegin(), all.cbegin() + nthreads);
+    } else {
+        std::size_t idx = 0;
+        while (cpus.size() < static_cast<std::size_t>(nthreads)) {
+            for (const auto& n : nodes) {
+                if (idx < n.cpus.size() && cpus.size() < static_cast<std::size_t>(nthreads))
+                    cpus.push_back(n.cpus[idx]);
+            }
+            ++idx;
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> ThreadAffinity::nodesForCpus(const std::vector<int>& cpus)
+{
+    std::vector<int> res;
+    for (const auto& node : numaNodes()) {
+        const bool used = std::any_of(cpus.cbegin(), cpus.cend(), [&](const auto c) {
+            return std::find(node.cpus.cbegin(), node.cpus.cend(), c) != node.cpus.cend();
+        });
+        if (used)
+            res.push_back(node.id);
+    }
+    return res;
+}
+
+bool ThreadAffinity::bindCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+    if (cpus.empty())
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto c : cpus)
+        if (c >= 0 && c < CPU_SETSIZE)
+            CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool ThreadAffinity::unbindCurrentThread()
+{
+    return bindCurrentThread(allowedCpus());
+}
+
+bool ThreadAffinity::setMemoryPlacement(MemoryPlacement placement, const std::vector<int>& nodes)
+{
+#ifdef __linux__
+    // values from linux/mempolicy.h, we avoid a dependency on libnuma
+    constexpr int MPOL_DEFAULT = 0;
+    constexpr int MPOL_INTERLEAVE = 3;
+    if (placement != MemoryPlacement::Interleaved || nodes.size() < 2)
+        return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+
+    constexpr std::size_t bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(1);
+    for (const auto n : nodes) {
+        const auto idx = static_cast<std::size_t>(n) / bits;
+        if (idx >= mask.size())
+            mask.resize(idx + 1, 0);
+        mask[idx] |= 1UL << (static_cast<std::size_t>(n) % bits);
+    }
+    return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask.data(), mask.size() * bits + 1) == 0;
+#else
+    return false;
+#endif
+}
+
+bool ThreadAffinity::resetMemoryPlacement()
+{
+    return setMemoryPlacement(MemoryPlacement::Default, {});
+}
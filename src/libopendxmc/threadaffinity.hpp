@@ -0,0 +1,62 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Helpers for placing simulation threads and memory on NUMA hosts. Threads
+// started by dxmc::Transport inherit the CPU mask of the thread that launches
+// them, so binding the simulation worker thread is sufficient to place the
+// transport threads. On platforms without support the functions are no-ops.
+class ThreadAffinity {
+public:
+    enum class ThreadPlacement : int {
+        None,
+        Compact,
+        Scatter
+    };
+    enum class MemoryPlacement : int {
+        Default,
+        FirstTouch,
+        Interleaved
+    };
+
+    struct NumaNode {
+        int id = 0; // kernel node id
+        std::vector<int> cpus;
+    };
+
+    // Linux cpulist format, i.e "0-3,8", empty on parse errors
+    static std::vector<int> parseCpuList(const std::string& list);
+    // Online NUMA nodes with CPUs, a single node with all CPUs if topology is unknown
+    static std::vector<NumaNode> numaNodes();
+    // CPUs the process was allowed to run on at startup (i.e restricted by taskset or cgroup cpusets),
+    // all CPUs if unknown
+    static const std::vector<int>& allowedCpus();
+    // Select nthreads of the allowed CPUs, compact fills one node before the next, scatter alternates between nodes
+    static std::vector<int> selectCpus(ThreadPlacement placement, int nthreads);
+    // Kernel ids of NUMA nodes owning any of the CPUs
+    static std::vector<int> nodesForCpus(const std::vector<int>& cpus);
+    static bool bindCurrentThread(const std::vector<int>& cpus);
+    // Restores the CPU mask the process had at startup
+    static bool unbindCurrentThread();
+    static bool setMemoryPlacement(MemoryPlacement placement, const std::vector<int>& nodes);
+    static bool resetMemoryPlacement();
+};
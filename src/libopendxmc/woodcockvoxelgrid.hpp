@@ -0,0 +1,444 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#pragma once
+
+#include "dxmc/dxmcrandom.hpp"
+#include "dxmc/interactions.hpp"
+#include "dxmc/material/material.hpp"
+#include "dxmc/particle.hpp"
+#include "dxmc/world/basicshapes/aabb.hpp"
+#include "dxmc/world/dosescore.hpp"
+#include "dxmc/world/energyscore.hpp"
+#include "dxmc/world/visualizationintersectionresult.hpp"
+#include "dxmc/world/worldintersectionresult.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+// Voxel grid world item using Woodcock delta tracking. The grid is divided into bricks of
+// BRICKSIZE^3 voxels, and within each brick photons are tracked with a majorant attenuation
+// coefficient for that brick instead of stepping voxel by voxel. This is efficient for
+// segmented images with few materials and large homogeneous regions. Empty bricks, i.e only
+// voxels with zero density, are skipped entirely.
+// NMATERIALS is the maximum number of materials, for small material counts the attenuation cache
+// and the material list of each brick are stored inline.
+// Optionally an importance is assigned to each brick for variance reduction. Photons crossing into a
+// brick of higher importance are split, and photons crossing into lower importance are subject to
+// Russian roulette. Weights are adjusted so that tallies are unbiased.
+// Dose may be scored in blocks of voxels instead of per voxel, see setDoseScoringBlock.
+template <std::size_t NMaterialShells = 5, int LOWENERGYCORRECTION = 2, std::size_t NMATERIALS = 256, std::size_t BRICKSIZE = 8>
+class WoodcockVoxelGrid {
+    static_assert(NMATERIALS > 0 && NMATERIALS <= 256, "Material index is stored as std::uint8_t");
+
+public:
+    WoodcockVoxelGrid() { }
+
+    bool setData(const std::array<std::size_t, 3>& dim, const std::vector<double>& density, const std::vector<std::uint8_t>& materialIdx, const std::vector<dxmc::Material<NMaterialShells>>& materials)
+    {
+        const auto size = std::reduce(dim.cbegin(), dim.cend(), std::size_t { 1 }, std::multiplies<>());
+        if (density.size() != size || materialIdx.size() != size || materials.size() > NMATERIALS)
+            return false;
+        const auto max_material = std::max_element(std::execution::par_unseq, materialIdx.cbegin(), materialIdx.cend());
+        if (max_material == materialIdx.cend() || *max_material >= materials.size())
+            return false;
+
+        m_dim = dim;
+        m_materials = materials;
+        m_data.resize(size);
+        std::transform(std::execution::par_unseq, density.cbegin(), density.cend(), materialIdx.cbegin(), m_data.begin(), [](const auto d, const auto m) {
+            return DataElement { .density = d, .materialIndex = m };
+        });
+        m_importance.clear();
+        updateScoring();
+        updateBricks();
+        updateAABB();
+        return true;
+    }
+
+    // Energy and dose are tallied in blocks of block^3 voxels, tally indices are then block indices.
+    // Voxel c is tallied in block (c + offset) / block, the offset aligns blocks of a cropped grid
+    // with blocks of the full image. Block dose is energy imparted over mass of the block.
+    void setDoseScoringBlock(std::size_t block, const std::array<std::size_t, 3>& offset = { 0, 0, 0 })
+    {
+        m_scoreBlock = std::max(block, std::size_t { 1 });
+        for (std::size_t i = 0; i < 3; ++i)
+            m_scoreOffset[i] = m_scoreBlock > 1 ? offset[i] % m_scoreBlock : 0;
+        updateScoring();
+    }
+
+    std::size_t doseScoringBlock() const { return m_scoreBlock; }
+    // Dimensions of the tally grid, equals voxel dimensions if dose is scored per voxel
+    const std::array<std::size_t, 3>& doseScoringDimensions() const { return m_scoreDim; }
+
+    void setSpacing(const std::array<double, 3>& spacing)
+    {
+        m_spacing = spacing;
+        updateAABB();
+    }
+
+    // Importance of bricks from a mask of voxels of interest (non zero). Importance is one for bricks
+    // containing voxels of interest and is halved for each halvingDistance (mm) away from them, but not
+    // below minimumImportance. An empty mask, or a mask without voxels of interest, disables splitting.
+    bool setImportance(const std::vector<std::uint8_t>& mask, double halvingDistance = 30, double minimumImportance = 1.0 / 32)
+    {
+        m_importance.clear();
+        if (mask.size() != m_data.size() || halvingDistance <= 0)
+            return mask.empty();
+
+        // chessboard distance in bricks to nearest brick of interest by breadth first search
+        constexpr auto unvisited = std::numeric_limits<std::uint32_t>::max();
+        std::vector<std::uint32_t> distance(m_bricks.size(), unvisited);
+        std::vector<std::size_t> front;
+        for (std::size_t z = 0; z < m_dim[2]; ++z)
+            for (std::size_t y = 0; y < m_dim[1]; ++y)
+                for (std::size_t x = 0; x < m_dim[0]; ++x)
+                    if (mask[x + m_dim[0] * (y + m_dim[1] * z)] > 0) {
+                        const auto b = x / BRICKSIZE + m_brickDim[0] * (y / BRICKSIZE + m_brickDim[1] * (z / BRICKSIZE));
+                        if (distance[b] == unvisited) {
+                            distance[b] = 0;
+                            front.push_back(b);
+                        }
+                    }
+        if (front.empty())
+            return true;
+        std::vector<std::size_t> next;
+        for (std::uint32_t d = 1; !front.empty(); ++d) {
+            next.clear();
+            for (const auto b : front) {
+                const std::array<std::int64_t, 3> c = {
+                    static_cast<std::int64_t>(b % m_brickDim[0]),
+                    static_cast<std::int64_t>((b / m_brickDim[0]) % m_brickDim[1]),
+                    static_cast<std::int64_t>(b / (m_brickDim[0] * m_brickDim[1]))
+                };
+                for (std::int64_t k = std::max(c[2] - 1, std::int64_t { 0 }); k <= std::min(c[2] + 1, static_cast<std::int64_t>(m_brickDim[2]) - 1); ++k)
+                    for (std::int64_t j = std::max(c[1] - 1, std::int64_t { 0 }); j <= std::min(c[1] + 1, static_cast<std::int64_t>(m_brickDim[1]) - 1); ++j)
+                        for (std::int64_t i = std::max(c[0] - 1, std::int64_t { 0 }); i <= std::min(c[0] + 1, static_cast<std::int64_t>(m_brickDim[0]) - 1); ++i) {
+                            const auto n = i + m_brickDim[0] * (j + m_brickDim[1] * k);
+                            if (distance[n] == unvisited) {
+                                distance[n] = d;
+                                next.push_back(n);
+                            }
+                        }
+            }
+            std::swap(front, next);
+        }
+
+        const auto brickLength = BRICKSIZE * (m_spacing[0] + m_spacing[1] + m_spacing[2]) / 3;
+        m_importance.resize(m_bricks.size());
+        std::transform(distance.cbegin(), distance.cend(), m_importance.begin(), [=](const auto d) {
+            return std::max(std::pow(0.5, d * brickLength / halvingDistance), minimumImportance);
+        });
+        return true;
+    }
+
+    bool hasImportance() const { return !m_importance.empty(); }
+
+    std::size_t size() const { return m_data.size(); }
+    const std::array<std::size_t, 3>& dimensions() const { return m_dim; }
+    const std::array<double, 3>& spacing() const { return m_spacing; }
+
+    void translate(const std::array<double, 3>& dist)
+    {
+        for (std::size_t i = 0; i < 3; ++i) {
+            m_aabb[i] += dist[i];
+            m_aabb[i + 3] += dist[i];
+        }
+    }
+
+    std::array<double, 3> center() const
+    {
+        return { (m_aabb[0] + m_aabb[3]) / 2, (m_aabb[1] + m_aabb[4]) / 2, (m_aabb[2] + m_aabb[5]) / 2 };
+    }
+
+    const std::array<double, 6>& AABB() const { return m_aabb; }
+
+    dxmc::WorldIntersectionResult intersect(const dxmc::ParticleType auto& p) const
+    {
+        return dxmc::basicshape::AABB::intersect(p, m_aabb);
+    }
+
+    template <typename U>
+    dxmc::VisualizationIntersectionResult<U> intersectVisualization(const dxmc::ParticleType auto& p) const
+    {
+        return dxmc::basicshape::AABB::template intersectVisualization<U>(p, m_aabb);
+    }
+
+    const dxmc::EnergyScore& energyScored(std::size_t index = 0) const { return m_energyScore[index]; }
+
+    void clearEnergyScored()
+    {
+        for (auto& e : m_energyScore)
+            e.clear();
+    }
+
+    void addEnergyScoredToDoseScore(double calibration_factor = 1)
+    {
+        const auto volume = m_spacing[0] * m_spacing[1] * m_spacing[2];
+        std::vector<std::size_t> idx(m_energyScore.size());
+        std::iota(idx.begin(), idx.end(), 0);
+        std::for_each(std::execution::par_unseq, idx.cbegin(), idx.cend(), [&](const auto i) {
+            // summed density of a block times voxel volume is the block mass
+            const auto density = m_scoreBlock > 1 ? m_scoreDensity[i] : m_data[i].density;
+            m_doseScore[i].addScoredEnergy(m_energyScore[i], volume, density, calibration_factor);
+        });
+    }
+
+    const dxmc::DoseScore& doseScored(std::size_t index = 0) const { return m_doseScore[index]; }
+
+    void clearDoseScored()
+    {
+        for (auto& d : m_doseScore)
+            d.clear();
+    }
+
+    void transport(dxmc::ParticleType auto& p, dxmc::RandomState& state)
+    {
+        if (m_importance.empty()) {
+            transportParticle(p, state);
+            return;
+        }
+        // split photons are banked and transported after the primary
+        std::vector<std::decay_t<decltype(p)>> bank;
+        transportParticle(p, state, &bank);
+        while (!bank.empty()) {
+            auto split = bank.back();
+            bank.pop_back();
+            transportParticle(split, state, &bank);
+        }
+    }
+
+protected:
+    template <typename Particle>
+    void transportParticle(Particle& p, dxmc::RandomState& state, std::vector<Particle>* bank = nullptr)
+    {
+        // cached attenuation coefficients for current photon energy
+        std::array<dxmc::AttenuationValues, NMATERIALS> att;
+        std::array<double, NMATERIALS> attEnergy;
+        attEnergy.fill(-1);
+        auto attenuation = [&](std::uint8_t m) -> const dxmc::AttenuationValues& {
+            if (attEnergy[m] != p.energy) {
+                att[m] = m_materials[m].attenuationValues(p.energy);
+                attEnergy[m] = p.energy;
+            }
+            return att[m];
+        };
+
+        bool cont = dxmc::basicshape::AABB::pointInside(p.pos, m_aabb);
+        double importance = bank && cont ? m_importance[brickIndex(p.pos)] : 1;
+        while (cont) {
+            const auto brickIdx = brickIndex(p.pos);
+            const auto& brick = m_bricks[brickIdx];
+            const auto brickDist = distanceToBrickBorder(p, brickIdx);
+
+            double majorant = 0;
+            for (const auto& [m, maxDens] : brick.materials)
+                majorant = std::max(majorant, attenuation(m).sum() * maxDens);
+
+            const auto stepLen = majorant > 0 ? -std::log(state.randomUniform()) / majorant : std::numeric_limits<double>::max();
+            if (stepLen < brickDist) {
+                p.translate(stepLen);
+                const auto c = voxelCoordinate(p.pos);
+                const auto& voxel = m_data[c[0] + m_dim[0] * (c[1] + m_dim[1] * c[2])];
+                const auto& voxelAtt = attenuation(voxel.materialIndex);
+                const auto voxelAttSum = voxelAtt.sum() * voxel.density;
+                // rejection of virtual interactions
+                if (state.randomUniform() * majorant < voxelAttSum) {
+                    const auto intRes = dxmc::interactions::template interact<NMaterialShells, LOWENERGYCORRECTION>(voxelAtt, p, m_materials[voxel.materialIndex], state);
+                    m_energyScore[scoreIndex(c)].scoreEnergy(intRes.energyImparted);
+                    cont = intRes.particleAlive;
+                }
+            } else {
+                p.border_translate(brickDist);
+                cont = dxmc::basicshape::AABB::pointInside(p.pos, m_aabb);
+                if (bank && cont) {
+                    const auto nextImportance = m_importance[brickIndex(p.pos)];
+                    const auto ratio = nextImportance / importance;
+                    importance = nextImportance;
+                    if (ratio < 1) {
+                        if (state.randomUniform() < ratio) {
+                            p.weight /= ratio;
+                        } else {
+                            p.energy = 0;
+                            cont = false;
+                        }
+                    } else if (ratio > 1) {
+                        // number of photons is ratio in expectation
+                        auto n = static_cast<std::size_t>(ratio);
+                        if (state.randomUniform() < ratio - n)
+                            ++n;
+                        p.weight /= ratio;
+                        for (std::size_t i = 1; i < n; ++i)
+                            bank->push_back(p);
+                    }
+                }
+            }
+        }
+    }
+
+    struct DataElement {
+        double density = 0;
+        std::uint8_t materialIndex = 0;
+    };
+    struct BrickMaterial {
+        std::uint8_t material = 0;
+        double maxDensity = 0;
+    };
+    template <std::size_t N>
+    struct InlineBrickMaterials {
+        std::array<BrickMaterial, N> items;
+        std::uint8_t count = 0;
+        void push_back(const BrickMaterial& m) { items[count++] = m; }
+        auto begin() const { return items.cbegin(); }
+        auto end() const { return items.cbegin() + count; }
+    };
+    struct Brick {
+        // materials present in brick and their max density
+        std::conditional_t<(NMATERIALS <= 8), InlineBrickMaterials<NMATERIALS>, std::vector<BrickMaterial>> materials;
+    };
+
+    void updateAABB()
+    {
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto half = m_dim[i] * m_spacing[i] / 2;
+            m_aabb[i] = -half;
+            m_aabb[i + 3] = half;
+        }
+    }
+
+    void updateScoring()
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+            m_scoreDim[i] = (m_dim[i] + m_scoreOffset[i] + m_scoreBlock - 1) / m_scoreBlock;
+        const auto size = m_scoreDim[0] * m_scoreDim[1] * m_scoreDim[2];
+        m_energyScore.clear();
+        m_energyScore.resize(size);
+        m_doseScore.clear();
+        m_doseScore.resize(size);
+        m_scoreDensity.clear();
+        if (m_scoreBlock > 1 && !m_data.empty()) {
+            m_scoreDensity.resize(size, 0);
+            for (std::size_t z = 0; z < m_dim[2]; ++z)
+                for (std::size_t y = 0; y < m_dim[1]; ++y)
+                    for (std::size_t x = 0; x < m_dim[0]; ++x)
+                        m_scoreDensity[scoreIndex({ x, y, z })] += m_data[x + m_dim[0] * (y + m_dim[1] * z)].density;
+        }
+    }
+
+    std::size_t scoreIndex(const std::array<std::size_t, 3>& c) const
+    {
+        if (m_scoreBlock == 1)
+            return c[0] + m_dim[0] * (c[1] + m_dim[1] * c[2]);
+        std::array<std::size_t, 3> b;
+        for (std::size_t i = 0; i < 3; ++i)
+            b[i] = (c[i] + m_scoreOffset[i]) / m_scoreBlock;
+        return b[0] + m_scoreDim[0] * (b[1] + m_scoreDim[1] * b[2]);
+    }
+
+    void updateBricks()
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+            m_brickDim[i] = (m_dim[i] + BRICKSIZE - 1) / BRICKSIZE;
+        m_bricks.clear();
+        m_bricks.resize(m_brickDim[0] * m_brickDim[1] * m_brickDim[2]);
+
+        std::vector<std::size_t> zbricks(m_brickDim[2]);
+        std::iota(zbricks.begin(), zbricks.end(), 0);
+        std::for_each(std::execution::par, zbricks.cbegin(), zbricks.cend(), [&](const std::size_t bz) {
+            std::vector<double> maxDens(m_materials.size());
+            for (std::size_t by = 0; by < m_brickDim[1]; ++by)
+                for (std::size_t bx = 0; bx < m_brickDim[0]; ++bx) {
+                    std::fill(maxDens.begin(), maxDens.end(), 0.0);
+                    for (std::size_t z = bz * BRICKSIZE; z < std::min((bz + 1) * BRICKSIZE, m_dim[2]); ++z)
+                        for (std::size_t y = by * BRICKSIZE; y < std::min((by + 1) * BRICKSIZE, m_dim[1]); ++y)
+                            for (std::size_t x = bx * BRICKSIZE; x < std::min((bx + 1) * BRICKSIZE, m_dim[0]); ++x) {
+                                const auto& v = m_data[x + m_dim[0] * (y + m_dim[1] * z)];
+                                maxDens[v.materialIndex] = std::max(maxDens[v.materialIndex], v.density);
+                            }
+                    auto& brick = m_bricks[bx + m_brickDim[0] * (by + m_brickDim[1] * bz)];
+                    for (std::size_t m = 0; m < maxDens.size(); ++m)
+                        if (maxDens[m] > 0)
+                            brick.materials.push_back({ .material = static_cast<std::uint8_t>(m), .maxDensity = maxDens[m] });
+                }
+        });
+    }
+
+    std::array<std::size_t, 3> voxelCoordinate(const std::array<double, 3>& pos) const
+    {
+        std::array<std::size_t, 3> c;
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto v = static_cast<std::int64_t>((pos[i] - m_aabb[i]) / m_spacing[i]);
+            c[i] = static_cast<std::size_t>(std::clamp(v, std::int64_t { 0 }, static_cast<std::int64_t>(m_dim[i]) - 1));
+        }
+        return c;
+    }
+
+    std::size_t voxelIndex(const std::array<double, 3>& pos) const
+    {
+        const auto c = voxelCoordinate(pos);
+        return c[0] + m_dim[0] * (c[1] + m_dim[1] * c[2]);
+    }
+
+    std::size_t brickIndex(const std::array<double, 3>& pos) const
+    {
+        const auto c = voxelCoordinate(pos);
+        return c[0] / BRICKSIZE + m_brickDim[0] * (c[1] / BRICKSIZE + m_brickDim[1] * (c[2] / BRICKSIZE));
+    }
+
+    double distanceToBrickBorder(const dxmc::ParticleType auto& p, std::size_t brickIdx) const
+    {
+        const std::array<std::size_t, 3> b = {
+            brickIdx % m_brickDim[0],
+            (brickIdx / m_brickDim[0]) % m_brickDim[1],
+            brickIdx / (m_brickDim[0] * m_brickDim[1])
+        };
+        double dist = std::numeric_limits<double>::max();
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto lower = m_aabb[i] + b[i] * BRICKSIZE * m_spacing[i];
+            const auto upper = std::min(lower + BRICKSIZE * m_spacing[i], m_aabb[i + 3]);
+            if (p.dir[i] > 0)
+                dist = std::min(dist, (upper - p.pos[i]) / p.dir[i]);
+            else if (p.dir[i] < 0)
+                dist = std::min(dist, (lower - p.pos[i]) / p.dir[i]);
+        }
+        return std::max(dist, 0.0);
+    }
+
+private:
+    std::array<std::size_t, 3> m_dim = { 1, 1, 1 };
+    std::array<std::size_t, 3> m_brickDim = { 1, 1, 1 };
+    std::array<std::size_t, 3> m_scoreDim = { 1, 1, 1 };
+    std::array<std::size_t, 3> m_scoreOffset = { 0, 0, 0 };
+    std::size_t m_scoreBlock = 1;
+    std::array<double, 3> m_spacing = { 1, 1, 1 };
+    std::array<double, 6> m_aabb = { 0, 0, 0, 0, 0, 0 };
+    std::vector<DataElement> m_data;
+    std::vector<Brick> m_bricks;
+    std::vector<double> m_importance;
+    std::vector<dxmc::Material<NMaterialShells>> m_materials;
+    std::vector<dxmc::EnergyScore> m_energyScore;
+    std::vector<dxmc::DoseScore> m_doseScore;
+    std::vector<double> m_scoreDensity; // summed voxel density of each block, empty if scored per voxel
+};
@@ -0,0 +1,123 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <datacontainer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+bool testDoseUnits()
+{
+    DataContainer data;
+    data.setDimensions({ 2, 2, 2 });
+    data.setSpacing({ 1, 1, 1 });
+    const std::vector<double> dose(data.size(), 2.0);
+    data.setImageArray(DataContainer::ImageType::Dose, dose);
+
+    // stored dose is in mGy, display unit only changes the scale
+    bool success = data.doseUnits() == "mGy" && data.displayScale(DataContainer::ImageType::Dose) == 1;
+    data.setDoseUnits("uGy");
+    success = success && data.doseUnits() == "uGy" && data.displayScale(DataContainer::ImageType::Dose) == 1e3;
+    success = success && data.displayScale(DataContainer::ImageType::DoseDifference) == 1e3;
+    success = success && data.displayScale(DataContainer::ImageType::DoseVariance) == 1e6;
+    data.setDoseUnits("Gy");
+    success = success && data.doseUnits() == "Gy" && data.displayScale(DataContainer::ImageType::Dose) == 1e-3;
+    success = success && data.getDoseArray() == dose;
+    // unknown units are ignored
+    data.setDoseUnits("rad");
+    success = success && data.doseUnits() == "Gy";
+    // images without dose units are not scaled
+    success = success && data.displayScale(DataContainer::ImageType::Density) == 1 && data.displayScale(DataContainer::ImageType::DoseRatio) == 1;
+    if (!success)
+        std::cout << "Dose units failed\n";
+    return success;
+}
+
+bool testAirMask()
+{
+    DataContainer data;
+    data.setDimensions({ 2, 2, 2 });
+    data.setSpacing({ 1, 1, 1 });
+    const std::vector<double> dose(data.size(), 2.0);
+    data.setImageArray(DataContainer::ImageType::Dose, dose);
+    // masking needs a material array
+    data.setAirMasked(true);
+    bool success = !data.isAirMasked();
+
+    std::vector<std::uint8_t> material(data.size(), 1);
+    material[0] = 0;
+    material[3] = 0;
+    data.setImageArray(DataContainer::ImageType::Material, material);
+    success = success && data.isAirMasked() && data.airMask().size() == data.size();
+    for (std::size_t i = 0; i < data.size(); ++i)
+        success = success && (data.airMask()[i] != 0) == (material[i] == 0);
+
+    // toggling the mask keeps dose to air and gives a new ID
+    const auto id = data.ID();
+    data.setAirMasked(false);
+    success = success && !data.isAirMasked() && data.ID() != id && data.getDoseArray() == dose;
+    if (!success)
+        std::cout << "Air mask failed\n";
+    return success;
+}
+
+bool testDoseScoringBlock()
+{
+    DataContainer data;
+    data.setDimensions({ 5, 4, 3 });
+    data.setSpacing({ 1, 2, 3 });
+    std::vector<std::uint8_t> material(data.size(), 0);
+    material[data.size() - 1] = 1;
+    data.setImageArray(DataContainer::ImageType::Material, material);
+    data.setImageArray(DataContainer::ImageType::Dose, std::vector<double>(data.size(), 1.0));
+
+    // a new block size removes dose images, the last block along each axis is partial
+    data.setDoseScoringBlock(2);
+    bool success = !data.hasImage(DataContainer::ImageType::Dose) && data.doseSize() == 3 * 2 * 2;
+    success = success && data.doseDimensions() == std::array<std::size_t, 3> { 3, 2, 2 } && data.doseSpacing() == std::array<double, 3> { 2, 4, 6 };
+    success = success && !data.setImageArray(DataContainer::ImageType::Dose, std::vector<double>(data.size(), 1.0));
+    success = success && data.setImageArray(DataContainer::ImageType::Dose, std::vector<double>(data.doseSize(), 1.0));
+    success = success && data.hasImage(DataContainer::ImageType::Dose) && data.hasImage(DataContainer::ImageType::Material);
+    // voxel (4, 3, 2) is in block (2, 1, 1)
+    success = success && data.doseIndex(data.size() - 1) == data.doseSize() - 1 && data.doseIndex(1) == 0;
+    // a block is air only if all its voxels are
+    const auto& doseAir = data.doseAirMask();
+    success = success && doseAir.size() == data.doseSize() && !doseAir.back();
+    success = success && std::count(doseAir.cbegin(), doseAir.cend(), std::uint8_t { 1 }) == static_cast<std::ptrdiff_t>(data.doseSize() - 1);
+
+    data.setDoseScoringBlock(1);
+    success = success && data.doseSize() == data.size() && data.doseIndex(7) == 7 && data.doseAirMask().size() == data.size();
+    if (!success)
+        std::cout << "Dose scoring block failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testDoseUnits();
+    success = success && testAirMask();
+    success = success && testDoseScoringBlock();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
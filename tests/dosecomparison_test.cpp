@@ -0,0 +1,147 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <datacontainer.hpp>
+#include <dosecomparison.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+std::shared_ptr<DataContainer> testData(double doseScale, bool variance = true)
+{
+    auto data = std::make_shared<DataContainer>();
+    data->setDimensions({ 4, 3, 2 });
+    data->setSpacing({ 0.5, 0.5, 1.0 });
+    std::vector<double> density(data->size());
+    std::vector<double> dose(data->size());
+    std::vector<double> var(data->size());
+    std::vector<std::uint8_t> organ(data->size());
+    for (std::size_t i = 0; i < data->size(); ++i) {
+        density[i] = 1.0 + (i % 3) * 0.5;
+        // first voxel has no dose, ratio is zero there
+        dose[i] = i == 0 ? 0.0 : (1.0 + i % 4) * doseScale;
+        var[i] = 0.01 * dose[i];
+        organ[i] = i < data->size() / 2 ? 0 : 1;
+    }
+    data->setImageArray(DataContainer::ImageType::Density, density);
+    data->setImageArray(DataContainer::ImageType::Dose, dose);
+    if (variance)
+        data->setImageArray(DataContainer::ImageType::DoseVariance, var);
+    data->setImageArray(DataContainer::ImageType::Organ, organ);
+    data->setOrganNames({ "body", "liver" });
+    return data;
+}
+
+bool isClose(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max(1.0, std::abs(b));
+}
+
+bool testVoxelMaps()
+{
+    auto data = testData(1.5);
+    auto reference = testData(1.0);
+    auto comparison = DoseComparison::compare(data, reference);
+    bool success = comparison != nullptr;
+    const auto N = data->size();
+    success = success && comparison->difference().size() == N && comparison->ratio().size() == N && comparison->zScore().size() == N;
+    for (std::size_t i = 0; success && i < N; ++i) {
+        const auto d = data->getDoseArray()[i];
+        const auto r = reference->getDoseArray()[i];
+        const auto var = data->getDoseVarianceArray()[i] + reference->getDoseVarianceArray()[i];
+        success = success && isClose(comparison->difference()[i], d - r);
+        success = success && isClose(comparison->ratio()[i], r > 0 ? d / r : 0.0);
+        success = success && isClose(comparison->zScore()[i], var > 0 ? (d - r) / std::sqrt(var) : 0.0);
+    }
+    // z-score needs variance of at least one of the results
+    auto noVariance = DoseComparison::compare(testData(1.5, false), testData(1.0, false));
+    success = success && noVariance && noVariance->zScore().empty();
+    if (!success)
+        std::cout << "DoseComparison voxel maps failed\n";
+    return success;
+}
+
+bool testOrgans()
+{
+    auto data = testData(2.0);
+    auto reference = testData(1.0);
+    auto comparison = DoseComparison::compare(data, reference);
+    bool success = comparison && comparison->organs().size() == 2;
+    const auto voxelVolume = 0.5 * 0.5 * 1.0;
+    for (std::size_t o = 0; success && o < 2; ++o) {
+        double mass = 0, energy = 0, referenceEnergy = 0, variance = 0;
+        std::uint64_t voxels = 0;
+        for (std::size_t i = 0; i < data->size(); ++i) {
+            if (data->getOrganArray()[i] != o)
+                continue;
+            const auto m = data->getDensityArray()[i] * voxelVolume;
+            const auto var = data->getDoseVarianceArray()[i] + reference->getDoseVarianceArray()[i];
+            voxels++;
+            mass += m;
+            energy += data->getDoseArray()[i] * m;
+            referenceEnergy += reference->getDoseArray()[i] * m;
+            variance += var * m * m;
+        }
+        const auto& organ = comparison->organs()[o];
+        const auto dose = energy / mass;
+        const auto referenceDose = referenceEnergy / mass;
+        success = success && organ.name == data->getOrganNames()[o] && organ.voxels == voxels && isClose(organ.mass, mass);
+        success = success && isClose(organ.dose, dose) && isClose(organ.referenceDose, referenceDose);
+        success = success && isClose(organ.difference, dose - referenceDose) && isClose(organ.ratio, dose / referenceDose);
+        success = success && isClose(organ.zScore, (dose - referenceDose) / (std::sqrt(variance) / mass));
+    }
+    if (!success)
+        std::cout << "DoseComparison organs failed\n";
+    return success;
+}
+
+bool testIncompatible()
+{
+    auto data = testData(1.0);
+    auto other = std::make_shared<DataContainer>();
+    other->setDimensions({ 4, 3, 3 });
+    other->setSpacing({ 0.5, 0.5, 1.0 });
+    other->setImageArray(DataContainer::ImageType::Dose, std::vector<double>(other->size(), 1.0));
+    bool success = DoseComparison::compare(data, other) == nullptr;
+
+    auto spacing = testData(1.0);
+    spacing->setSpacing({ 0.5, 0.5, 1.5 });
+    success = success && DoseComparison::compare(data, spacing) == nullptr;
+
+    auto noDose = testData(1.0);
+    noDose->removeImage(DataContainer::ImageType::Dose);
+    success = success && DoseComparison::compare(data, noDose) == nullptr;
+    if (!success)
+        std::cout << "DoseComparison of incompatible results failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testVoxelMaps();
+    success = success && testOrgans();
+    success = success && testIncompatible();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
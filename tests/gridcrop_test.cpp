@@ -0,0 +1,88 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <gridcrop.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+bool testGridCrop()
+{
+    // body occupies x in [1, 3], y in [1, 2] and z = 1
+    const std::array<std::size_t, 3> dim = { 6, 4, 3 };
+    const auto N = dim[0] * dim[1] * dim[2];
+    std::vector<std::uint8_t> material(N, 0);
+    std::vector<std::size_t> full(N);
+    for (std::size_t z = 0; z < dim[2]; ++z)
+        for (std::size_t y = 0; y < dim[1]; ++y)
+            for (std::size_t x = 0; x < dim[0]; ++x) {
+                const auto idx = x + dim[0] * (y + dim[1] * z);
+                full[idx] = idx;
+                if (x >= 1 && x <= 3 && y >= 1 && y <= 2 && z == 1)
+                    material[idx] = 1;
+            }
+
+    const GridCrop crop(dim, material);
+    bool success = crop.isCropped();
+    success = success && crop.dimensions() == std::array<std::size_t, 3> { 3, 2, 1 } && crop.size() == 6;
+    // cropped grid center is half a voxel below full grid center along x
+    const auto offset = crop.offset({ 1, 2, 3 });
+    success = success && offset[0] == -0.5 && offset[1] == 0 && offset[2] == 0;
+
+    // every voxel inside the box maps to the cropped copy of itself, all others are outside
+    const auto cropped = crop.crop(full);
+    std::size_t inside = 0;
+    for (std::size_t idx = 0; idx < N; ++idx) {
+        const auto c = crop.gridIndex(idx);
+        if (material[idx] > 0) {
+            success = success && c < crop.size() && cropped[c] == idx;
+            ++inside;
+        } else {
+            success = success && c == crop.size();
+        }
+    }
+    success = success && inside == crop.size();
+    if (!success)
+        std::cout << "GridCrop of body failed\n";
+    return success;
+}
+
+bool testGridCropAir()
+{
+    // only air keeps the full grid
+    const std::array<std::size_t, 3> dim = { 3, 3, 3 };
+    const GridCrop crop(dim, std::vector<std::uint8_t>(27, 0));
+    bool success = !crop.isCropped() && crop.size() == 27;
+    for (std::size_t idx = 0; idx < 27; ++idx)
+        success = success && crop.gridIndex(idx) == idx;
+    if (!success)
+        std::cout << "GridCrop of air failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testGridCrop();
+    success = success && testGridCropAir();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
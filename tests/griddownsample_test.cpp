@@ -0,0 +1,83 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <griddownsample.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+bool testGridDownsample()
+{
+    // dimensions not divisible by factor gives partial blocks at the upper edges
+    const std::array<std::size_t, 3> dim = { 5, 4, 3 };
+    const std::size_t factor = 2;
+    const auto N = dim[0] * dim[1] * dim[2];
+    const GridDownsample downsample(dim, factor);
+    bool success = downsample.dimensions() == std::array<std::size_t, 3> { 3, 2, 2 } && downsample.size() == 12;
+    const auto offset = downsample.offset({ 1, 1, 1 });
+    success = success && offset[0] == 0.5 && offset[1] == 0 && offset[2] == 0.5;
+    const auto spacing = downsample.spacing({ 0.1, 0.2, 0.3 });
+    success = success && spacing[0] == 0.1 * factor && spacing[1] == 0.2 * factor && spacing[2] == 0.3 * factor;
+
+    // brute force block of each voxel and mean of voxel indices in each block
+    std::vector<double> density(N);
+    std::vector<double> sum(downsample.size(), 0);
+    std::vector<double> count(downsample.size(), 0);
+    for (std::size_t z = 0; z < dim[2]; ++z)
+        for (std::size_t y = 0; y < dim[1]; ++y)
+            for (std::size_t x = 0; x < dim[0]; ++x) {
+                const auto idx = x + dim[0] * (y + dim[1] * z);
+                const auto block = x / factor + 3 * (y / factor + 2 * (z / factor));
+                success = success && downsample.gridIndex(idx) == block;
+                density[idx] = static_cast<double>(idx);
+                sum[block] += density[idx];
+                count[block] += 1;
+            }
+    const auto down = downsample.downsampleDensity(density);
+    for (std::size_t b = 0; b < down.size(); ++b)
+        success = success && std::abs(down[b] - sum[b] / count[b]) < 1e-9;
+    if (!success)
+        std::cout << "GridDownsample index map failed\n";
+    return success;
+}
+
+bool testGridDownsampleMaterial()
+{
+    // most frequent material of each block is selected
+    const std::array<std::size_t, 3> dim = { 2, 2, 2 };
+    const GridDownsample downsample(dim, 2);
+    const std::vector<std::uint8_t> material = { 0, 3, 3, 1, 3, 0, 2, 3 };
+    const auto down = downsample.downsampleMaterial(material);
+    const bool success = down.size() == 1 && down[0] == 3;
+    if (!success)
+        std::cout << "GridDownsample material failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testGridDownsample();
+    success = success && testGridDownsampleMaterial();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
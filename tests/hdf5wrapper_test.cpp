@@ -0,0 +1,219 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <datacontainer.hpp>
+#include <hdf5wrapper.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Smallest container the wrapper loads, i.e with materials and density
+std::shared_ptr<DataContainer> testData()
+{
+    auto data = std::make_shared<DataContainer>();
+    data->setDimensions({ 4, 3, 2 });
+    data->setSpacing({ 0.1, 0.2, 0.3 });
+    std::vector<std::uint8_t> material(data->size(), 1);
+    material[0] = 0;
+    material[5] = 0;
+    data->setImageArray(DataContainer::ImageType::Material, material);
+    data->setMaterials({ { .name = "air", .Z = { { 7, 0.76 }, { 8, 0.24 } } }, { .name = "water", .Z = { { 1, 0.111 }, { 8, 0.889 } } } });
+    std::vector<double> density(data->size(), 1.0);
+    density[0] = 0.001;
+    density[5] = 0.001;
+    data->setImageArray(DataContainer::ImageType::Density, density);
+    return data;
+}
+
+std::shared_ptr<DataContainer> saveAndLoad(std::shared_ptr<DataContainer> data)
+{
+    const auto path = (std::filesystem::temp_directory_path() / "opendxmc_hdf5wrapper_test.h5").string();
+    {
+        HDF5Wrapper file(path, HDF5Wrapper::FileOpenMode::WriteOver);
+        if (!file.save(data))
+            return nullptr;
+    }
+    HDF5Wrapper file(path, HDF5Wrapper::FileOpenMode::ReadOnly);
+    return file.load();
+}
+
+bool testOrganDoses()
+{
+    auto data = testData();
+    std::vector<DataContainer::OrganDose> organs(2);
+    organs[0] = { .name = "liver", .voxels = 12, .volume = 0.072, .mass = 0.075, .dose = 1.5, .variance = 0.01, .events = 1000 };
+    organs[1] = { .name = "lung", .voxels = 3, .volume = 0.018, .mass = 0.005, .dose = 0.25, .variance = 0.002, .events = 20 };
+    data->setOrganDoses(organs);
+
+    auto loaded = saveAndLoad(data);
+    bool success = loaded && loaded->hasOrganDoses() && loaded->getOrganDoses().size() == organs.size();
+    for (std::size_t i = 0; success && i < organs.size(); ++i) {
+        const auto& o = loaded->getOrganDoses()[i];
+        success = success && o.name == organs[i].name && o.voxels == organs[i].voxels;
+        success = success && o.volume == organs[i].volume && o.mass == organs[i].mass;
+        success = success && o.dose == organs[i].dose && o.variance == organs[i].variance && o.events == organs[i].events;
+    }
+    // organ dose only results have no dose image
+    success = success && !loaded->hasImage(DataContainer::ImageType::Dose);
+    if (!success)
+        std::cout << "Organ dose round trip failed\n";
+    return success;
+}
+
+bool testSimulationStatistics()
+{
+    auto data = testData();
+    DataContainer::SimulationStatistics statistics;
+    statistics.version = "1.0.0";
+    statistics.host = "host";
+    statistics.cpuArchitecture = "x86_64";
+    statistics.operatingSystem = "Linux";
+    statistics.trackingMethod = "Voxel tracking";
+    statistics.logicalCpus = 16;
+    statistics.threads = 12;
+    statistics.correctionLevel = 2;
+    statistics.worldBuildTime = 0.5;
+    statistics.pilotTime = 0.25;
+    statistics.transportTime = 10.5;
+    statistics.doseCollectionTime = 0.125;
+    statistics.wallTime = 11.5;
+    statistics.histories = 123456789;
+    statistics.varianceReduction = true;
+    statistics.figureOfMerit = 2.5e4;
+    statistics.beams = { { .name = "Beam 1", .transportTime = 4.5, .histories = 1000 }, { .name = "Beam 2", .transportTime = 6, .histories = 2000 } };
+    data->setSimulationStatistics(statistics);
+
+    auto loaded = saveAndLoad(data);
+    bool success = loaded && loaded->hasSimulationStatistics();
+    if (success) {
+        const auto& s = loaded->getSimulationStatistics();
+        success = success && s.version == statistics.version && s.host == statistics.host;
+        success = success && s.cpuArchitecture == statistics.cpuArchitecture && s.operatingSystem == statistics.operatingSystem;
+        success = success && s.trackingMethod == statistics.trackingMethod;
+        success = success && s.logicalCpus == statistics.logicalCpus && s.threads == statistics.threads && s.correctionLevel == statistics.correctionLevel;
+        success = success && s.worldBuildTime == statistics.worldBuildTime && s.pilotTime == statistics.pilotTime;
+        success = success && s.transportTime == statistics.transportTime && s.doseCollectionTime == statistics.doseCollectionTime;
+        success = success && s.wallTime == statistics.wallTime && s.histories == statistics.histories;
+        success = success && s.varianceReduction == statistics.varianceReduction && s.figureOfMerit == statistics.figureOfMerit;
+        success = success && s.beams.size() == statistics.beams.size();
+        for (std::size_t i = 0; success && i < s.beams.size(); ++i) {
+            success = success && s.beams[i].name == statistics.beams[i].name;
+            success = success && s.beams[i].transportTime == statistics.beams[i].transportTime && s.beams[i].histories == statistics.beams[i].histories;
+        }
+    }
+    if (!success)
+        std::cout << "Simulation statistics round trip failed\n";
+    return success;
+}
+
+bool testDoseUnits()
+{
+    auto data = testData();
+    std::vector<double> dose(data->size());
+    std::iota(dose.begin(), dose.end(), 1.0);
+    data->setImageArray(DataContainer::ImageType::Dose, dose);
+    data->setDoseUnits("Gy");
+
+    // dose is stored in mGy regardless of display unit
+    auto loaded = saveAndLoad(data);
+    const bool success = loaded && loaded->doseUnits() == "Gy" && loaded->getDoseArray() == dose;
+    if (!success)
+        std::cout << "Dose units round trip failed\n";
+    return success;
+}
+
+bool testDoseAirMasked()
+{
+    bool success = true;
+    for (const auto masked : { true, false }) {
+        auto data = testData();
+        const std::vector<double> dose(data->size(), 1.0);
+        data->setImageArray(DataContainer::ImageType::Dose, dose);
+        data->setAirMasked(masked);
+        // dose to air is saved and masked again when loaded
+        auto loaded = saveAndLoad(data);
+        success = success && loaded && loaded->isAirMasked() == masked && loaded->getDoseArray() == dose;
+    }
+    if (!success)
+        std::cout << "Dose air masking round trip failed\n";
+    return success;
+}
+
+bool testDoseScoringBlock()
+{
+    auto data = testData();
+    data->setDoseScoringBlock(2);
+    std::vector<double> dose(data->doseSize());
+    std::iota(dose.begin(), dose.end(), 1.0);
+    data->setImageArray(DataContainer::ImageType::Dose, dose);
+    data->setImageArray(DataContainer::ImageType::DoseVariance, dose);
+
+    // dose images are saved with the block resolution
+    auto loaded = saveAndLoad(data);
+    const bool success = loaded && loaded->doseScoringBlock() == 2 && loaded->getDoseArray() == dose && loaded->getDoseVarianceArray() == dose;
+    if (!success)
+        std::cout << "Dose scoring block round trip failed\n";
+    return success;
+}
+
+bool testSweepResults()
+{
+    auto data = testData();
+    // the second result is a skipped batch phantom without doses
+    std::vector<DataContainer::SweepResult> results(3);
+    results[0] = { .name = "80 kV", .doses = { { .name = "liver", .voxels = 12, .volume = 0.072, .mass = 0.075, .dose = 1.5, .variance = 0.01, .events = 1000 } } };
+    results[1] = { .name = "Phantom (does not fit in memory)" };
+    results[2] = { .name = "120 kV", .doses = { { .name = "liver", .voxels = 12, .volume = 0.072, .mass = 0.075, .dose = 3.5, .variance = 0.02, .events = 2000 }, { .name = "lung", .voxels = 3, .volume = 0.018, .mass = 0.005, .dose = 0.5, .variance = 0.004, .events = 40 } } };
+    data->setSweepResults(results);
+
+    auto loaded = saveAndLoad(data);
+    bool success = loaded && loaded->hasSweepResults() && loaded->getSweepResults().size() == results.size();
+    for (std::size_t r = 0; success && r < results.size(); ++r) {
+        const auto& result = loaded->getSweepResults()[r];
+        success = success && result.name == results[r].name && result.doses.size() == results[r].doses.size();
+        for (std::size_t i = 0; success && i < result.doses.size(); ++i) {
+            const auto& o = result.doses[i];
+            const auto& e = results[r].doses[i];
+            success = success && o.name == e.name && o.voxels == e.voxels && o.volume == e.volume && o.mass == e.mass;
+            success = success && o.dose == e.dose && o.variance == e.variance && o.events == e.events;
+        }
+    }
+    if (!success)
+        std::cout << "Sweep results round trip failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testOrganDoses();
+    success = success && testSimulationStatistics();
+    success = success && testDoseUnits();
+    success = success && testDoseAirMasked();
+    success = success && testDoseScoringBlock();
+    success = success && testSweepResults();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
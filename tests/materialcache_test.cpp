@@ -0,0 +1,65 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <materialcache.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+bool testMaterialCacheByWeight()
+{
+    MaterialCache::clear();
+    // water by mass fractions, scaled and unnormalized compositions share one entry
+    const auto water = MaterialCache::byWeight({ { 1, 0.111894 }, { 8, 0.888106 } });
+    const auto scaled = MaterialCache::byWeight({ { 1, 11.1894 }, { 8, 88.8106 } });
+    bool success = water && scaled && MaterialCache::size() == 1;
+    const auto other = MaterialCache::byWeight({ { 1, 0.2 }, { 8, 0.8 } });
+    success = success && other && MaterialCache::size() == 2;
+    // elements with zero weight does not change the key
+    const auto zero = MaterialCache::byWeight({ { 1, 0.111894 }, { 8, 0.888106 }, { 20, 0.0 } });
+    success = success && zero && MaterialCache::size() == 2;
+    MaterialCache::clear();
+    success = success && MaterialCache::size() == 0;
+    if (!success)
+        std::cout << "MaterialCache by weight failed\n";
+    return success;
+}
+
+bool testMaterialCacheByNistName()
+{
+    MaterialCache::clear();
+    const auto first = MaterialCache::byNistName("Water, Liquid");
+    const auto second = MaterialCache::byNistName("Water, Liquid");
+    bool success = first && second && MaterialCache::size() == 1;
+    // unknown names are not cached
+    success = success && !MaterialCache::byNistName("not a material") && MaterialCache::size() == 1;
+    MaterialCache::clear();
+    if (!success)
+        std::cout << "MaterialCache by NIST name failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testMaterialCacheByWeight();
+    success = success && testMaterialCacheByNistName();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,74 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <organaccumulator.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+bool testAccumulateOrgans()
+{
+    // organ 1 in even voxels and organ 2 in odd voxels, dose equals voxel index
+    const std::size_t N = 1000;
+    std::vector<std::uint8_t> organs(N);
+    std::vector<double> density(N, 2.0);
+    for (std::size_t i = 0; i < N; ++i)
+        organs[i] = static_cast<std::uint8_t>(1 + i % 2);
+    const double voxelVolume = 0.5;
+    const auto voxelDose = [](const std::size_t i) { return VoxelDose { .dose = static_cast<double>(i), .variance = 1.0, .events = 2.0 }; };
+
+    const auto total = accumulateOrgans(organs, density, voxelVolume, {}, voxelDose);
+    bool success = total[0].voxels == 0 && total[1].voxels == N / 2 && total[2].voxels == N / 2;
+    success = success && std::abs(total[1].mass - N / 2.0) < 1e-9;
+    // mean dose of even indices is N / 2 - 1, of odd indices N / 2
+    success = success && std::abs(total[1].energy / total[1].mass - (N / 2.0 - 1)) < 1e-9;
+    success = success && std::abs(total[2].energy / total[2].mass - N / 2.0) < 1e-9;
+    // independent voxels, variance scales with mass squared
+    success = success && std::abs(total[1].variance - N / 2.0) < 1e-9 && std::abs(total[1].events - N) < 1e-9;
+
+    // masked voxels count towards voxels and mass but not dose
+    std::vector<std::uint8_t> mask(N, 0);
+    for (std::size_t i = 0; i < N / 2; ++i)
+        mask[i] = 1;
+    const auto masked = accumulateOrgans(organs, density, voxelVolume, mask, voxelDose);
+    success = success && masked[1].voxels == N / 2 && std::abs(masked[1].mass - total[1].mass) < 1e-9;
+    double energy = 0;
+    for (std::size_t i = N / 2; i < N; i += 2)
+        energy += static_cast<double>(i);
+    success = success && std::abs(masked[1].energy - energy) < 1e-9 && std::abs(masked[1].events - N / 2.0) < 1e-9;
+
+    // a mask of the wrong size is ignored
+    const auto ignored = accumulateOrgans(organs, density, voxelVolume, std::vector<std::uint8_t>(N / 2, 1), voxelDose);
+    success = success && std::abs(ignored[1].energy - total[1].energy) < 1e-9;
+
+    if (!success)
+        std::cout << "accumulateOrgans failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testAccumulateOrgans();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
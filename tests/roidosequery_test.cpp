@@ -0,0 +1,152 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <datacontainer.hpp>
+#include <roidosequery.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+std::shared_ptr<DataContainer> testData()
+{
+    auto data = std::make_shared<DataContainer>();
+    data->setDimensions({ 5, 4, 3 });
+    data->setSpacing({ 0.5, 1.0, 2.0 });
+    std::vector<double> density(data->size());
+    std::vector<double> dose(data->size());
+    std::vector<std::uint8_t> organ(data->size());
+    for (std::size_t i = 0; i < data->size(); ++i) {
+        density[i] = 0.5 + (i % 7) * 0.25;
+        dose[i] = 1.0 + (i % 5) * 0.5;
+        organ[i] = i % 3 == 0 ? 1 : 0;
+    }
+    data->setImageArray(DataContainer::ImageType::Density, density);
+    data->setImageArray(DataContainer::ImageType::Dose, dose);
+    data->setImageArray(DataContainer::ImageType::Organ, organ);
+    return data;
+}
+
+// Mass weighted mean dose of voxels for which inside(x, y, z, index) is true
+template <typename Inside>
+ROIDoseQuery::Result bruteForce(std::shared_ptr<DataContainer> data, Inside inside)
+{
+    const auto& dim = data->dimensions();
+    const auto& spacing = data->spacing();
+    const auto voxelVolume = spacing[0] * spacing[1] * spacing[2];
+    ROIDoseQuery::Result res;
+    double energy = 0;
+    for (std::size_t z = 0; z < dim[2]; ++z)
+        for (std::size_t y = 0; y < dim[1]; ++y)
+            for (std::size_t x = 0; x < dim[0]; ++x) {
+                const auto i = x + dim[0] * (y + dim[1] * z);
+                if (inside(x, y, z, i)) {
+                    const auto mass = data->getDensityArray()[i] * voxelVolume;
+                    energy += data->getDoseArray()[i] * mass;
+                    res.mass += mass;
+                    res.voxels++;
+                }
+            }
+    res.dose = res.mass > 0 ? energy / res.mass : 0;
+    return res;
+}
+
+bool isEqual(const ROIDoseQuery::Result& a, const ROIDoseQuery::Result& b)
+{
+    return a.voxels == b.voxels && std::abs(a.mass - b.mass) < 1e-9 && std::abs(a.dose - b.dose) < 1e-9;
+}
+
+bool testBoxIndices()
+{
+    auto data = testData();
+    auto query = ROIDoseQuery::create(data);
+    bool success = query != nullptr;
+    const auto& dim = data->dimensions();
+    // every box in the grid
+    for (std::size_t x0 = 0; success && x0 < dim[0]; ++x0)
+        for (std::size_t x1 = x0 + 1; x1 <= dim[0]; ++x1)
+            for (std::size_t y0 = 0; y0 < dim[1]; ++y0)
+                for (std::size_t y1 = y0 + 1; y1 <= dim[1]; ++y1)
+                    for (std::size_t z0 = 0; z0 < dim[2]; ++z0)
+                        for (std::size_t z1 = z0 + 1; z1 <= dim[2]; ++z1) {
+                            const auto expected = bruteForce(data, [&](std::size_t x, std::size_t y, std::size_t z, std::size_t) {
+                                return x >= x0 && x < x1 && y >= y0 && y < y1 && z >= z0 && z < z1;
+                            });
+                            success = success && isEqual(query->box(std::array<std::size_t, 6> { x0, y0, z0, x1, y1, z1 }), expected);
+                        }
+    // empty and out of range boxes
+    success = success && query->box(std::array<std::size_t, 6> { 2, 0, 0, 2, 4, 3 }).voxels == 0;
+    success = success && isEqual(query->box(std::array<std::size_t, 6> { 0, 0, 0, 10, 10, 10 }), bruteForce(data, [](auto, auto, auto, auto) { return true; }));
+    if (!success)
+        std::cout << "ROIDoseQuery box by index failed\n";
+    return success;
+}
+
+bool testBoxCorners()
+{
+    auto data = testData();
+    auto query = ROIDoseQuery::create(data);
+    // voxel centers along x are at -1, -0.5, 0, 0.5 and 1 cm, the box includes the three center voxels
+    const std::array<double, 6> corners = { -0.6, -2, -3, 0.6, 2, 3 };
+    const auto expected = bruteForce(data, [](std::size_t x, std::size_t, std::size_t, std::size_t) { return x >= 1 && x <= 3; });
+    bool success = isEqual(query->box(corners), expected);
+    const auto organExpected = bruteForce(data, [&](std::size_t x, std::size_t, std::size_t, std::size_t i) { return x >= 1 && x <= 3 && data->getOrganArray()[i] == 1; });
+    success = success && isEqual(query->box(corners, 1), organExpected);
+    if (!success)
+        std::cout << "ROIDoseQuery box by corners failed\n";
+    return success;
+}
+
+bool testSphere()
+{
+    auto data = testData();
+    auto query = ROIDoseQuery::create(data);
+    const std::array<double, 3> center = { 0.25, 0.5, 0 };
+    const double radius = 1.1;
+    const auto& dim = data->dimensions();
+    const auto& spacing = data->spacing();
+    auto inside = [&](std::size_t x, std::size_t y, std::size_t z, std::size_t) {
+        const std::array<std::size_t, 3> idx = { x, y, z };
+        double d2 = 0;
+        for (std::size_t k = 0; k < 3; ++k) {
+            const auto p = (idx[k] + 0.5) * spacing[k] - dim[k] * spacing[k] / 2 - center[k];
+            d2 += p * p;
+        }
+        return d2 <= radius * radius;
+    };
+    const auto expected = bruteForce(data, inside);
+    bool success = expected.voxels > 0 && isEqual(query->sphere(center, radius), expected);
+    if (!success)
+        std::cout << "ROIDoseQuery sphere failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testBoxIndices();
+    success = success && testBoxCorners();
+    success = success && testSphere();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <beamactorcontainer.hpp>
+#include <datacontainer.hpp>
+#include <dxmc_specialization.hpp>
+#include <simulationpipeline.hpp>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Water cube surrounded by air
+std::shared_ptr<DataContainer> testData()
+{
+    auto data = std::make_shared<DataContainer>();
+    const std::array<std::size_t, 3> dim = { 12, 12, 12 };
+    data->setDimensions(dim);
+    data->setSpacing({ 1, 1, 1 });
+    std::vector<std::uint8_t> material(data->size(), 0);
+    std::vector<double> density(data->size(), 0.001);
+    for (std::size_t z = 2; z < 10; ++z)
+        for (std::size_t y = 2; y < 10; ++y)
+            for (std::size_t x = 2; x < 10; ++x) {
+                const auto idx = x + dim[0] * (y + dim[1] * z);
+                material[idx] = 1;
+                density[idx] = 1;
+            }
+    data->setImageArray(DataContainer::ImageType::Material, material);
+    data->setImageArray(DataContainer::ImageType::Density, density);
+    data->setMaterials({ { .name = "air", .Z = { { 7, 0.76 }, { 8, 0.24 } } }, { .name = "water", .Z = { { 1, 0.111894 }, { 8, 0.888106 } } } });
+    return data;
+}
+
+std::shared_ptr<BeamActorContainer> testBeam()
+{
+    DXBeam dx;
+    dx.setNumberOfExposures(4);
+    dx.setNumberOfParticlesPerExposure(2000);
+    return std::make_shared<BeamActorContainer>(std::make_shared<Beam>(dx));
+}
+
+// Starts a run and waits until the pipeline reports it is no longer running, returns the result
+std::shared_ptr<DataContainer> runAndWait(SimulationPipeline& pipeline, std::function<void()> start)
+{
+    std::shared_ptr<DataContainer> result = nullptr;
+    bool finished = false;
+    QEventLoop loop;
+    auto running = QObject::connect(&pipeline, &SimulationPipeline::simulationRunning, [&](bool on) {
+        if (!on) {
+            finished = true;
+            loop.quit();
+        }
+    });
+    auto changed = QObject::connect(&pipeline, &SimulationPipeline::imageDataChanged, [&](std::shared_ptr<DataContainer> data) { result = data; });
+    QTimer::singleShot(300000, &loop, &QEventLoop::quit);
+    start();
+    if (!finished)
+        loop.exec();
+    QObject::disconnect(running);
+    QObject::disconnect(changed);
+    return finished ? result : nullptr;
+}
+
+bool hasDose(std::shared_ptr<DataContainer> data)
+{
+    if (!data || !data->hasImage(DataContainer::ImageType::Dose) || !data->hasSimulationStatistics())
+        return false;
+    const auto& dose = data->getDoseArray();
+    return std::any_of(dose.cbegin(), dose.cend(), [](const auto d) { return d > 0; });
+}
+
+bool testBackToBack()
+{
+    SimulationPipeline pipeline;
+    pipeline.setNumberOfThreads(2);
+    pipeline.updateImageData(testData());
+    pipeline.addBeamActor(testBeam());
+
+    // the second run must not see the stopped progress left by the first
+    auto first = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    bool success = hasDose(first);
+    const auto firstHistories = success ? first->getSimulationStatistics().histories : 0;
+    auto second = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    success = success && hasDose(second) && second->getSimulationStatistics().histories == firstHistories;
+    if (!success)
+        std::cout << "Back to back simulations failed\n";
+    return success;
+}
+
+bool testAdaptiveBackToBack()
+{
+    SimulationPipeline pipeline;
+    pipeline.setNumberOfThreads(2);
+    pipeline.setAdaptiveBeamAllocation(true);
+    pipeline.updateImageData(testData());
+    pipeline.addBeamActor(testBeam());
+    pipeline.addBeamActor(testBeam());
+
+    // pilot runs are followed by a check of progress before the main transport
+    auto first = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    auto second = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    const bool success = hasDose(first) && hasDose(second) && second->getSimulationStatistics().pilotTime > 0;
+    if (!success)
+        std::cout << "Back to back adaptive simulations failed\n";
+    return success;
+}
+
+bool testSweepAfterRun()
+{
+    SimulationPipeline pipeline;
+    pipeline.setNumberOfThreads(2);
+    pipeline.updateImageData(testData());
+    pipeline.addBeamActor(testBeam());
+
+    // every variant of the sweep checks progress before and after transport
+    auto first = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    auto sweep = runAndWait(pipeline, [&]() { pipeline.startSweep("60, 80", "", "", ""); });
+    bool success = hasDose(first) && sweep && sweep->getSweepResults().size() == 2;
+    if (success) {
+        for (const auto& r : sweep->getSweepResults())
+            success = success && std::any_of(r.doses.cbegin(), r.doses.cend(), [](const auto& d) { return d.dose > 0; });
+    }
+    if (!success)
+        std::cout << "Sweep after simulation failed\n";
+    return success;
+}
+
+bool testBlockScoring()
+{
+    SimulationPipeline pipeline;
+    pipeline.setNumberOfThreads(2);
+    pipeline.setWorldItemType(1);
+    pipeline.setDoseScoringBlockSize(2);
+    pipeline.updateImageData(testData());
+    pipeline.addBeamActor(testBeam());
+
+    // Woodcock tracking tallies dose in blocks, dose images are stored per block
+    auto result = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    const bool success = hasDose(result) && result->doseScoringBlock() == 2 && result->getDoseArray().size() == 6 * 6 * 6;
+    if (!success)
+        std::cout << "Block dose scoring failed\n";
+    return success;
+}
+
+bool testCropIndependentOfAirMask()
+{
+    SimulationPipeline pipeline;
+    pipeline.setNumberOfThreads(2);
+    pipeline.setDeleteAirDose(false);
+    pipeline.setCropAir(true);
+    pipeline.updateImageData(testData());
+    pipeline.addBeamActor(testBeam());
+
+    // air is cropped with air dose unmasked, only the water cube is simulated
+    auto result = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    bool success = hasDose(result) && !result->isAirMasked();
+    if (success) {
+        const auto& dose = result->getDoseArray();
+        const auto& material = result->getMaterialArray();
+        for (std::size_t i = 0; i < dose.size(); ++i)
+            success = success && (material[i] > 0 || dose[i] == 0);
+    }
+    if (!success)
+        std::cout << "Crop of air with unmasked air dose failed\n";
+    return success;
+}
+
+bool testAirMaskFromData()
+{
+    SimulationPipeline pipeline;
+    std::optional<bool> emitted;
+    QObject::connect(&pipeline, &SimulationPipeline::deleteAirDoseChanged, [&](bool on) { emitted = on; });
+
+    // dose saved without air masking, e.g loaded from file
+    auto data = testData();
+    data->setImageArray(DataContainer::ImageType::Dose, std::vector<double>(data->size(), 1.0));
+    data->setAirMasked(false);
+    pipeline.updateImageData(data);
+    bool success = emitted && !emitted.value();
+
+    // the pipeline follows the loaded state, the next run keeps dose to air unmasked
+    pipeline.setNumberOfThreads(2);
+    pipeline.addBeamActor(testBeam());
+    auto result = runAndWait(pipeline, [&]() { pipeline.startSimulation(); });
+    success = success && hasDose(result) && !result->isAirMasked();
+    if (!success)
+        std::cout << "Air masking from image data failed\n";
+    return success;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    bool success = true;
+    success = success && testBackToBack();
+    success = success && testAdaptiveBackToBack();
+    success = success && testSweepAfterRun();
+    success = success && testBlockScoring();
+    success = success && testCropIndependentOfAirMask();
+    success = success && testAirMaskFromData();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <threadaffinity.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+bool testParseCpuList()
+{
+    bool success = ThreadAffinity::parseCpuList("0-3,8") == std::vector<int> { 0, 1, 2, 3, 8 };
+    success = success && ThreadAffinity::parseCpuList("5") == std::vector<int> { 5 };
+    success = success && ThreadAffinity::parseCpuList("0,2,4-5") == std::vector<int> { 0, 2, 4, 5 };
+    success = success && ThreadAffinity::parseCpuList("").empty();
+    // parse errors gives an empty list
+    success = success && ThreadAffinity::parseCpuList("0-1,a").empty();
+    if (!success)
+        std::cout << "parseCpuList failed\n";
+    return success;
+}
+
+bool testNumaNodes()
+{
+    const auto nodes = ThreadAffinity::numaNodes();
+    bool success = !nodes.empty();
+    // kernel node ids are unique and sorted, but need not be contiguous
+    for (std::size_t i = 1; i < nodes.size(); ++i)
+        success = success && nodes[i - 1].id < nodes[i].id;
+    success = success && std::all_of(nodes.cbegin(), nodes.cend(), [](const auto& n) { return !n.cpus.empty(); });
+
+    // nodes of the CPUs the process is allowed to use
+    const auto& allowed = ThreadAffinity::allowedCpus();
+    std::vector<int> ids;
+    for (const auto& n : nodes)
+        if (std::any_of(n.cpus.cbegin(), n.cpus.cend(), [&](const auto c) { return std::find(allowed.cbegin(), allowed.cend(), c) != allowed.cend(); }))
+            ids.push_back(n.id);
+    success = success && ThreadAffinity::nodesForCpus(ThreadAffinity::selectCpus(ThreadAffinity::ThreadPlacement::None, 0)) == ids;
+    success = success && ThreadAffinity::nodesForCpus({ nodes.back().cpus.front() }) == std::vector<int> { nodes.back().id };
+    if (!success)
+        std::cout << "numaNodes failed\n";
+    return success;
+}
+
+bool testSelectCpus()
+{
+    const auto all = ThreadAffinity::selectCpus(ThreadAffinity::ThreadPlacement::None, 0);
+    bool success = !all.empty();
+    for (const auto placement : { ThreadAffinity::ThreadPlacement::Compact, ThreadAffinity::ThreadPlacement::Scatter }) {
+        const auto cpus = ThreadAffinity::selectCpus(placement, 1);
+        success = success && cpus.size() == 1 && std::find(all.cbegin(), all.cend(), cpus.front()) != all.cend();
+    }
+    if (!success)
+        std::cout << "selectCpus failed\n";
+    return success;
+}
+
+bool testAllowedCpus()
+{
+    // selections never leave the CPU set of the process
+    const auto& allowed = ThreadAffinity::allowedCpus();
+    bool success = !allowed.empty();
+    auto isAllowed = [&](const auto c) { return std::find(allowed.cbegin(), allowed.cend(), c) != allowed.cend(); };
+    for (const auto placement : { ThreadAffinity::ThreadPlacement::None, ThreadAffinity::ThreadPlacement::Compact, ThreadAffinity::ThreadPlacement::Scatter }) {
+        const auto cpus = ThreadAffinity::selectCpus(placement, 2);
+        success = success && !cpus.empty() && std::all_of(cpus.cbegin(), cpus.cend(), isAllowed);
+    }
+    success = success && ThreadAffinity::selectCpus(ThreadAffinity::ThreadPlacement::None, 0).size() == allowed.size();
+
+#ifdef __linux__
+    // unbinding restores the startup mask
+    auto currentCpus = []() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &set))
+                    cpus.push_back(c);
+        return cpus;
+    };
+    std::thread worker([&]() {
+        ThreadAffinity::bindCurrentThread({ allowed.front() });
+        success = success && currentCpus() == std::vector<int> { allowed.front() };
+        ThreadAffinity::unbindCurrentThread();
+        success = success && currentCpus() == allowed;
+    });
+    worker.join();
+#endif
+    if (!success)
+        std::cout << "allowedCpus failed\n";
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success = success && testParseCpuList();
+    success = success && testNumaNodes();
+    success = success && testSelectCpus();
+    success = success && testAllowedCpus();
+    if (success)
+        return EXIT_SUCCESS;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,109 @@
+/*This file is part of OpenDXMC.
+
+OpenDXMC is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenDXMC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenDXMC. If not, see < https://www.gnu.org/licenses/>.
+
+Copyright 2024 Erlend Andersen
+*/
+
+#include <dxmc_specialization.hpp>
+#include <hdf5wrapper.hpp>
+#include <woodcockvoxelgrid.hpp>
+
+#include "dxmc/transport.hpp"
+#include "dxmc/transportprogress.hpp"
+#include "dxmc/world/world.hpp"
+#include "dxmc/world/worlditems/aavoxelgrid.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Benchmark of photon tracking methods. Loads saved OpenDXMC projects (i.e ICRP phantom
+// or CT images with beams) and prints histories per second for each world item.
+
+template <typename VoxelGrid>
+double benchmark(std::shared_ptr<DataContainer> data, const std::vector<std::shared_ptr<BeamActorContainer>>& beams, double& buildTime)
+{
+    using World = dxmc::World<VoxelGrid>;
+    World world;
+    auto& vgrid = world.template addItem<VoxelGrid>();
+
+    const auto build_start = std::chrono::steady_clock::now();
+    std::vector<Material> materials;
+    for (const auto& m : data->getMaterials()) {
+        auto material = Material::byWeight(m.Z);
+        if (!material)
+            return 0;
+        materials.push_back(material.value());
+    }
+    vgrid.setData(data->dimensions(), data->getDensityArray(), data->getMaterialArray(), materials);
+    vgrid.setSpacing(data->spacing());
+    world.build();
+    buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+    dxmc::Transport transport;
+    dxmc::TransportProgress progress;
+    std::uint64_t histories = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (auto& b : beams) {
+        std::visit([&](auto&& beam) {
+            transport(world, beam, &progress, true);
+            histories += beam.numberOfExposures() * beam.numberOfParticlesPerExposure();
+        },
+            *(b->getBeam()));
+    }
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    return time.count() > 0 ? histories / time.count() : 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "Usage: transportbenchmark project1.h5 [project2.h5 ...]\n";
+        return 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string path = argv[i];
+        HDF5Wrapper file(path, HDF5Wrapper::FileOpenMode::ReadOnly);
+        auto data = file.load();
+        auto beams = file.loadBeams();
+        if (!data || beams.empty()) {
+            std::cout << path << ": no image data or beams\n";
+            continue;
+        }
+        std::cout << path << " (" << data->getMaterials().size() << " materials)\n";
+        double build = 0;
+        auto voxel = benchmark<dxmc::AAVoxelGrid<5, 1, 255>>(data, beams, build);
+        std::cout << "  Voxel tracking:          " << voxel << " histories/sec, world build " << build << " sec\n";
+        auto woodcock = benchmark<WoodcockVoxelGrid<5, 1>>(data, beams, build);
+        std::cout << "  Woodcock delta tracking: " << woodcock << " histories/sec, world build " << build << " sec\n";
+        if (voxel > 0)
+            std::cout << "  Speedup: " << woodcock / voxel << "\n";
+
+        // specializations for small material counts, compared to the general 256 material grid
+        const auto nmaterials = data->getMaterials().size();
+        double woodcockSmall = 0;
+        if (nmaterials <= 8)
+            woodcockSmall = benchmark<WoodcockVoxelGrid<5, 1, 8>>(data, beams, build);
+        else if (nmaterials <= 32)
+            woodcockSmall = benchmark<WoodcockVoxelGrid<5, 1, 32>>(data, beams, build);
+        if (woodcockSmall > 0) {
+            std::cout << "  Woodcock delta tracking, " << (nmaterials <= 8 ? 8 : 32) << " material grid: " << woodcockSmall << " histories/sec, world build " << build << " sec\n";
+            if (woodcock > 0)
+                std::cout << "  Speedup: " << woodcockSmall / woodcock << "\n";
+        }
+    }
+    return 0;
+}